@@ -0,0 +1,41 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It declares
+ *          the stuff used to notice suspends and clock changes.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#ifndef __clocks_h
+#define __clocks_h
+
+#include "config.h"
+#include "timer.h"
+
+typedef struct
+{
+  unsigned long resumes;       /* number of suspends noticed      */
+  unsigned long steps;         /* number of wall clock changes    */
+  msecs         suspended;     /* total time spent suspended      */
+  msecs         lastSuspended; /* duration of the latest suspend  */
+} clockStats;
+
+extern clockStats clockStatistics;
+
+extern void watchClocks (void);
+extern void checkClocks (void);
+extern void reportClockStats (void);
+
+#endif /* __clocks_h */
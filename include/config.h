@@ -39,7 +39,13 @@
 
 #ifndef VMS
 #include <pwd.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/wait.h>
+#include <sys/syscall.h>
+#ifdef __linux__
+#include <sys/timerfd.h>
+#endif /* __linux__ */
 #endif /* VMS */
 
 #ifdef VMS
@@ -91,6 +97,29 @@
                                          force-lock areas                  */
 #define CORNER_DELAY      5           /* number of seconds to wait
                                          before forcing a lock             */
+#define PRESPAWN_MARGIN   5           /* number of seconds before locking
+                                         to start the locker ahead of time
+                                         if not using -notify              */
+#define PRESPAWN_ENV      "XAUTOLOCK_PRESPAWN"
+                                      /* set in the environment of such a
+                                         locker                            */
+
+#define MAX_PASSWORD_LEN  255         /* as it says, for the built-in
+                                         locker                            */
+#define PAM_SERVICE       "xautolock" /* PAM service used by the latter    */
+
+#define POLL_INTERVAL     1000        /* number of milliseconds between
+                                         checks for user activity          */
+#define MIN_ROUND_TRIPS   2           /* minimum -roundtrips budget per
+                                         minute                            */
+
+#define MIN_SUSPEND       10          /* number of milliseconds the clocks
+                                         must drift apart to count as a
+                                         suspend                           */
+
+#define LATENCY_TIMEOUT   60          /* number of seconds after which to
+                                         stop waiting for the locker to
+                                         get the screen                    */
 
 #ifdef VMS
 #define SLOW_VMS_DELAY    15          /* explained in VMS.NOTES file       */
@@ -108,6 +137,74 @@
 
 #define ID                ""          /* unique id per xautolock process   */
 
+#define HOOK_TIMEOUT      0           /* default number of seconds a hook
+                                         may run, 0 meaning forever        */
+#define MAX_HOOKS         4           /* default number of hooks that may
+                                         be running at the same time       */
+#define MAX_HOOK_JOBS     16          /* maximum ...                       */
+#define HOOK_CAPTURE_SIZE 512         /* bytes of hook stderr to keep      */
+
+#define IPC_RATE          20          /* number of messages per second a
+                                         single sender may send ...        */
+#define IPC_BURST         40          /* ... with bursts of up to this     */
+#define IPC_SENDERS       16          /* number of senders kept track of   */
+#define IPC_BATCH         16          /* maximum number of messages handled
+                                         per main loop iteration           */
+
+#define CGROUP_ROOT       "/sys/fs/cgroup"
+                                      /* where the cgroup v2 hierarchy is
+                                         mounted                           */
+#define SESSION_TIMEOUT   250         /* number of milliseconds to wait for
+                                         a freeze or thaw to take effect   */
+#define SESSION_RECHECK   2           /* number of milliseconds between
+                                         looks at stopped processes        */
+#define DEMOTE_NICE       19          /* nice value of a demoted session's
+                                         threads ...                       */
+#define DEMOTE_WEIGHT     1           /* ... or cpu.weight and io.weight of
+                                         its cgroup                        */
+#define MIN_RECLAIM_MINS  1           /* minimum number of minutes locked
+                                         before reclaiming memory          */
+#define RECLAIM_BATCH     64          /* number of megabytes paged out per
+                                         batch ...                         */
+#define RECLAIM_RANGES    64          /* ... in at most this many ranges   */
+#define RECLAIM_PAUSE     250         /* milliseconds between batches      */
+
+#define PSI_WINDOW        2000000     /* memory pressure trigger window in
+                                         microseconds                      */
+#define PSI_SOME          200000      /* microseconds per window that some
+                                         tasks may stall on memory before
+                                         the pressure counts as some ...   */
+#define PSI_FULL          100000      /* ... and that all of them may stall
+                                         before it counts as full          */
+#define PSI_EASE          30000       /* number of milliseconds without
+                                         triggers before the pressure
+                                         counts as one level lower         */
+
+#define STAGGER_FILE      "/run/lock/xautolock.stagger"
+                                      /* where instances keep count of the
+                                         lockers they start                */
+#define STAGGER_LAUNCHES  8           /* number of lockers that may start
+                                         within ...                        */
+#define STAGGER_WINDOW    2           /* ... this many seconds before the
+                                         next one has to wait              */
+#define STAGGER_SPREAD    500         /* number of milliseconds to spread
+                                         per locker above that             */
+#define STAGGER_SANE      64          /* number of lockers above which a
+                                         count is taken to be garbage      */
+#define MAX_STAGGER       120         /* maximum number of seconds a
+                                         locker may be held back           */
+
+#define TRACE_SIZE        4096        /* number of flight recorder
+                                         records kept                      */
+#define TRACE_FILE        "/tmp/%s.%ld.trace"
+                                      /* where to dump them, given our
+                                         name and process id               */
+
+#define METRICS_SIZE      32768       /* maximum size of the metrics page  */
+
+#define PROFILE_INTERVAL  60          /* seconds between two -profile
+                                         summaries                         */
+
 #define DUMMY_RES_CLASS   "_xAx_"     /* some X versions don't like a 0
                                          class name, and implementing real
 				         classes isn't worth it            */
@@ -0,0 +1,79 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It declares
+ *          the display layer: the clock, plus the X requests and process
+ *          handling the main loop depends on.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#ifndef __display_h
+#define __display_h
+
+#include "config.h"
+#include "timer.h"
+#include "launch.h"
+
+/*
+ *  Everything the engine needs from the outside world goes through
+ *  here, so that it can be run against a simulated display and clock
+ *  (see tools/simulate.c). The built-in locker and the DIY window tree
+ *  walk are left out, they can't be simulated in any meaningful way.
+ */
+typedef struct
+{
+  const char* name;
+
+ /*
+  *  The clock, and the select () used to wait for things to happen.
+  */
+  msecs  (*now)            (void);
+  int    (*wait)           (int nfds, fd_set* fds, struct timeval* timeout);
+
+ /*
+  *  Activity. queryIdle () returns the milliseconds since the last
+  *  input event, queryPointer () the screen the pointer is on.
+  */
+  Time   (*queryIdle)      (Display* d, Bool useXidle);
+  void   (*queryPointer)   (Display* d, int* x, int* y, unsigned* mask,
+                            Screen** screen);
+
+ /*
+  *  Events.
+  */
+  int    (*pending)        (Display* d);
+  void   (*nextEvent)      (Display* d, XEvent* event);
+  Bool   (*checkMaskEvent) (Display* d, long mask, XEvent* event);
+  Status (*sendEvent)      (Display* d, Window w, XEvent* event);
+
+ /*
+  *  Odds and ends.
+  */
+  void   (*sync)           (Display* d);
+  void   (*bell)           (Display* d, int percent);
+  void   (*selectInput)    (Display* d, Window w, long mask);
+  Status (*getAttributes)  (Display* d, Window w, XWindowAttributes* attribs);
+
+ /*
+  *  The locker. reapLocker () works like waitpid () with WNOHANG.
+  */
+  pid_t  (*launchLocker)   (commandType type);
+  pid_t  (*reapLocker)     (pid_t pid, int* status);
+} displayOps;
+
+extern const displayOps  xlibOps; /* the real thing */
+extern const displayOps* dpy;     /* the one in use */
+
+#endif /* __display_h */
@@ -23,8 +23,12 @@
 
 #include "config.h"
 
+extern Bool lookAtUser (Bool diy);
+extern Bool pointerNeeded (Bool diy);
 extern void queryPointer (Display* d);
 extern void queryIdleTime (Display* d, Bool useXidle);
 extern void evaluateTriggers (Display* d);
+extern Bool checkLocker (void);
+extern Bool lockerTracked (void);
 
 #endif /* engine_h */
@@ -0,0 +1,45 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It declares
+ *          the stuff used to run the notifier and killer hooks without
+ *          ever blocking the main loop.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#ifndef __hook_h
+#define __hook_h
+
+#include "config.h"
+#include "launch.h"
+
+typedef struct
+{
+  unsigned long runs;      /* number of finished runs            */
+  unsigned long failures;  /* not started, crashed or exit != 0  */
+  unsigned long timeouts;  /* killed for taking too long         */
+  unsigned long dropped;   /* not started, too many jobs around  */
+  unsigned long totalUsec; /* summed run time of finished runs   */
+  unsigned long maxUsec;   /* longest run time                   */
+} hookStats;
+
+extern hookStats hookStatistics[cmd_count];
+
+extern void runHook (commandType type);
+extern void checkHooks (void);
+extern Bool hooksRunning (void);
+extern void reportHookStats (void);
+
+#endif /* __hook_h */
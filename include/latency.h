@@ -0,0 +1,70 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It declares
+ *          the stuff used to measure how long locking takes.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#ifndef __latency_h
+#define __latency_h
+
+#include "config.h"
+#include "timer.h"
+
+typedef enum
+{
+  lk_locker,     /* the -locker command      */
+  lk_nowLocker,  /* the -nowlocker command   */
+  lk_builtin,    /* the built-in locker      */
+  lk_count       /* number of the above      */
+} lockKind;
+
+typedef enum
+{
+  ls_spawned,    /* locker started           */
+  ls_locked,     /* locker owns the screen   */
+  ls_count       /* number of the above      */
+} lockStage;
+
+/*
+ *  Bucket b counts latencies of up to 2^b milliseconds, the last one
+ *  everything beyond that.
+ */
+#define LATENCY_BUCKETS 18
+
+typedef struct
+{
+  unsigned long buckets[LATENCY_BUCKETS]; /* as it says               */
+  unsigned long count;                    /* as it says               */
+  msecs         sum;                      /* as it says               */
+  msecs         max;                      /* as it says               */
+} latencyHistogram;
+
+extern latencyHistogram lockLatency[lk_count][ls_count];
+extern unsigned long    lockTimeouts[lk_count];
+extern const char*      lockKindNames[lk_count];
+extern const char*      lockStageNames[ls_count];
+
+extern void  startLockLatency (Display* d, lockKind kind, msecs deadline);
+extern void  lockConfirmed (void);
+extern void  abandonLockLatency (void);
+extern Bool  lockLatencyPending (void);
+extern void  checkLockLatency (Display* d);
+extern void  handleLatencyEvent (Display* d, XEvent* event);
+extern msecs bucketLimit (int bucket);
+extern msecs latencyPercentile (const latencyHistogram* h, int percent);
+
+#endif /* __latency_h */
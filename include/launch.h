@@ -0,0 +1,51 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It declares
+ *          the stuff used to start the locker, notifier and killer.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#ifndef __launch_h
+#define __launch_h
+
+#include "config.h"
+
+typedef enum
+{
+  cmd_locker,     /* the -locker command     */
+  cmd_nowLocker,  /* the -nowlocker command  */
+  cmd_notifier,   /* the -notifier command   */
+  cmd_killer,     /* the -killer command     */
+  cmd_authHelper, /* the -authhelper command */
+  cmd_count       /* number of the above     */
+} commandType;
+
+typedef struct
+{
+  unsigned long spawns;    /* number of successful spawns  */
+  unsigned long failures;  /* number of failed spawns      */
+  unsigned long totalUsec; /* summed spawn latency         */
+  unsigned long maxUsec;   /* worst spawn latency          */
+} spawnStats;
+
+extern spawnStats  spawnStatistics[cmd_count];
+extern const char* commandNames[cmd_count];
+
+extern void  prepareCommand (commandType type, const char* text);
+extern pid_t launchCommand (commandType type, int inFd, int errFd);
+extern void  reportSpawnStats (void);
+
+#endif /* __launch_h */
@@ -0,0 +1,32 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It declares
+ *          the built-in locker.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#ifndef __lock_h
+#define __lock_h
+
+#include "config.h"
+
+extern Bool lockScreen (Display* d);
+extern void unlockScreen (void);
+extern Bool screenLocked (void);
+extern void checkLock (void);
+extern Bool handleLockEvent (Display* d, XEvent* event);
+
+#endif /* __lock_h */
@@ -0,0 +1,63 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It declares
+ *          the stuff used to keep and serve run time metrics.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#ifndef __metrics_h
+#define __metrics_h
+
+#include "config.h"
+#include "options.h"
+#include "timer.h"
+
+typedef enum
+{
+  xs_pointer,  /* queryPointer ()                 */
+  xs_idle,     /* queryIdleTime ()                */
+  xs_diy,      /* DIY mode window tree traversal  */
+  xs_count     /* number of the above             */
+} xSource;
+
+typedef struct
+{
+  unsigned long wakeups;                /* main loop iterations      */
+  unsigned long xRequests[xs_count];    /* X requests issued         */
+  unsigned long xRoundTrips[xs_count];  /* ... that had to wait      */
+  unsigned long ipcRequests[msg_count]; /* messages received by type */
+  unsigned long ipcDropped;             /* ... over the rate limit   */
+  unsigned long ipcCoalesced;           /* ... answered from the
+                                           previous one             */
+  unsigned long diyQueueDepth;          /* windows waiting in queue  */
+  msecs         lastActivity;           /* as it says                */
+} metricsData;
+
+extern metricsData metrics;
+
+/*
+ *  X request counting is done by means of the request sequence
+ *  numbers, which costs next to nothing.
+ */
+#define countRequestsFrom(d)      unsigned long firstRequest = NextRequest (d)
+#define countRequestsTo(d,source) (metrics.xRequests[source] += \
+                                     NextRequest (d) - firstRequest)
+#define countRoundTrip(source)    (++metrics.xRoundTrips[source])
+
+extern void initMetrics (void);
+extern void cleanupMetrics (void);
+
+#endif /* __metrics_h */
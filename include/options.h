@@ -30,6 +30,14 @@ typedef enum
   ca_forceLock   /* lock immediately */
 } cornerAction;
 
+typedef enum
+{
+  bk_auto,       /* first one available: Xidle, MIT, DIY */
+  bk_xidle,      /* the Xidle extension                  */
+  bk_mit,        /* the MIT-SCREEN-SAVER extension       */
+  bk_diy         /* watch the window tree ourselves      */
+} backendType;
+
 typedef enum
 {
   msg_none,      /* as it says                           */
@@ -41,6 +49,9 @@ typedef enum
   msg_unlockNow, /* tell running xautolock to unlock now */
   msg_restart,   /* tell running xautolock to restart    */
   msg_isDisabled, /* ask running xautolock for disabled status */
+  msg_dumpTrace, /* tell running xautolock to dump its trace */
+  msg_lockLatency, /* ask running xautolock how fast it locks */
+  msg_count      /* number of the above                  */
 } message;
 
 typedef enum
@@ -49,23 +60,29 @@ typedef enum
   response_success,   /* requested operation succeeded */
   response_failure,   /* requested operation failed    */
   response_bool,      /* second element contains bool  */
+  response_latency,   /* count, p50, p90 and p99       */
 } response;
 
 /*
  *  Global option settings. Documented in options.c. 
  *  Do not modify any of these from outside that file.
  */
-extern const char   *locker, *nowLocker, *notifier, *killer, *id;
-extern time_t       lockTime, killTime, notifyMargin,
-                    cornerDelay, cornerRedelay;
-extern int          bellPercent;
+extern const char   *locker, *nowLocker, *notifier, *killer, *id,
+                    *authHelper, *metricsPath, *profilePath, *cgroupDir;
+extern time_t       lockTime, killTime, minKillTime, maxKillTime, notifyMargin,
+                    cornerDelay, cornerRedelay, hookTimeout, reclaimTime,
+                    staggerMax;
+extern int          bellPercent, maxHooks, maxRoundTrips;
 extern unsigned     cornerSize;
 extern Bool         secure, notifyLock, useRedelay, resetSaver, 
-                    noCloseOut, noCloseErr, detectSleep;
+                    noCloseOut, noCloseErr, detectSleep, useShell,
+                    captureHooks, builtinLocker, useFreezer,
+                    useDemotion, measureLocks, prespawn;
 extern cornerAction corners[4];
+extern backendType  backend;
 extern message      messageToSend; 
 
-extern Bool         killerSpecified, notifierSpecified;
+extern Bool         killerSpecified, notifierSpecified, authHelperSpecified;
 
 #ifdef VMS
 extern struct dsc$descriptor lockerDescr, nowLockerDescr;
@@ -0,0 +1,58 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It declares
+ *          the stuff used to get the locker ready before it is needed.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#ifndef __prespawn_h
+#define __prespawn_h
+
+#include "config.h"
+#include "timer.h"
+
+#ifndef VMS
+#define HasPrespawn
+#endif /* VMS */
+
+typedef enum
+{
+  ps_started,   /* locker started ahead of time */
+  ps_ready,     /* locker said it was ready     */
+  ps_used,      /* locker told to lock          */
+  ps_cancelled  /* locker sent away again       */
+} prespawnStage;
+
+typedef struct
+{
+  unsigned long started;   /* lockers started ahead of time   */
+  unsigned long ready;     /* ... that said they were ready   */
+  unsigned long used;      /* ... that got told to lock       */
+  unsigned long late;      /* ... of which weren't ready then */
+  unsigned long cancelled; /* ... that got sent away again    */
+  msecs         setup;     /* summed time to get ready        */
+  msecs         ahead;     /* summed time left at that point  */
+} prespawnStats;
+
+extern prespawnStats prespawnStatistics;
+
+extern void  prespawnLocker (void);
+extern pid_t takePrespawned (void);
+extern void  cancelPrespawn (void);
+extern void  checkPrespawn (void);
+extern void  reportPrespawnStats (void);
+
+#endif /* __prespawn_h */
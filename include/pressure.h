@@ -0,0 +1,52 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It declares
+ *          the stuff used to scale the kill time with memory pressure.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#ifndef __pressure_h
+#define __pressure_h
+
+#include "config.h"
+#include "timer.h"
+
+typedef enum
+{
+  pl_none,     /* no memory pressure to speak of */
+  pl_some,     /* some tasks stalled on memory   */
+  pl_full,     /* all tasks stalled on memory    */
+  pl_count     /* number of the above            */
+} pressureLevel;
+
+typedef struct
+{
+  unsigned long events;         /* PSI trigger events seen         */
+  unsigned long changes;        /* pressure level changes          */
+  msecs         atLevel[pl_count];
+                                /* time spent at each level before
+                                   the current one                 */
+} pressureStats;
+
+extern pressureStats pressureStatistics;
+
+extern void          watchPressure (void);
+extern void          easePressure (void);
+extern pressureLevel pressure (void);
+extern time_t        killDelay (void);
+extern void          reportPressureStats (void);
+
+#endif /* __pressure_h */
@@ -0,0 +1,55 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It declares
+ *          the USDT probes used for profiling with bpftrace, perf and
+ *          friends. Without HasSdt they compile to nothing at all, and
+ *          even with it, a probe that nobody is listening to costs a
+ *          single nop. See tools/phases.bt for an example.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#ifndef __probes_h
+#define __probes_h
+
+#ifdef HasSdt
+#include <sys/sdt.h>
+
+#define PROBE0(name)          DTRACE_PROBE  (xautolock, name)
+#define PROBE1(name,a1)       DTRACE_PROBE1 (xautolock, name, a1)
+#define PROBE2(name,a1,a2)    DTRACE_PROBE2 (xautolock, name, a1, a2)
+#define PROBE3(name,a1,a2,a3) DTRACE_PROBE3 (xautolock, name, a1, a2, a3)
+#else /* HasSdt */
+#define PROBE0(name)
+#define PROBE1(name,a1)
+#define PROBE2(name,a1,a2)
+#define PROBE3(name,a1,a2,a3)
+#endif /* HasSdt */
+
+/*
+ *  First argument of the reset_triggers probe, telling what made
+ *  us reset the triggers.
+ */
+typedef enum
+{
+  rs_idle,     /* server says the user was active   */
+  rs_pointer,  /* pointer moved                     */
+  rs_key,      /* key pressed (DIY mode)            */
+  rs_corner,   /* pointer in a `-' corner           */
+  rs_message,  /* enable or toggle message          */
+  rs_disabled  /* we're disabled                    */
+} resetSource;
+
+#endif /* __probes_h */
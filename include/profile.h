@@ -0,0 +1,51 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It declares
+ *          the stuff used to profile the phases of the main loop.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#ifndef __profile_h
+#define __profile_h
+
+#include "config.h"
+
+typedef enum
+{
+  pp_idle,      /* queryIdleTime ()    */
+  pp_diy,       /* processEvents ()    */
+  pp_pointer,   /* queryPointer ()     */
+  pp_triggers,  /* evaluateTriggers () */
+  pp_messages,  /* lookForMessages ()  */
+  pp_count      /* number of the above */
+} profilePhase;
+
+extern Bool profiling; /* whether -profile was given */
+
+/*
+ *  startProfile () is called at the top of the main loop, endPhase ()
+ *  after each phase. Each phase gets charged for everything since the
+ *  previous call.
+ */
+#define startProfile(d)   (profiling ? markProfile (d) : (void) 0)
+#define endPhase(d,phase) (profiling ? chargePhase (d, phase) : (void) 0)
+
+extern void initProfile (void);
+extern void markProfile (Display* d);
+extern void chargePhase (Display* d, profilePhase phase);
+extern void cleanupProfile (void);
+
+#endif /* __profile_h */
@@ -0,0 +1,77 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It declares
+ *          the stuff used to act on the processes of a locked session.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#ifndef __session_h
+#define __session_h
+
+#include "config.h"
+#include "timer.h"
+
+#if defined (SYS_pidfd_open) && defined (SYS_pidfd_send_signal)
+#define HasPidfd
+#endif /* SYS_pidfd_open && SYS_pidfd_send_signal */
+
+#if defined (SYS_process_madvise) && defined (SYS_pidfd_open)
+#define HasReclaim
+#endif /* SYS_process_madvise && SYS_pidfd_open */
+
+typedef struct
+{
+  unsigned long freezes;         /* number of freezes                 */
+  unsigned long unconfirmed;     /* freezes and thaws not confirmed in
+                                    time                              */
+  unsigned long freezeUsec;      /* summed freeze latency             */
+  unsigned long maxFreezeUsec;   /* worst freeze latency              */
+  unsigned long thawUsec;        /* summed thaw latency               */
+  unsigned long maxThawUsec;     /* worst thaw latency                */
+  msecs         frozenMsec;      /* time spent frozen                 */
+  msecs         reclaimedMsec;   /* CPU time the session would have
+                                    used meanwhile                    */
+  unsigned long demotions;       /* number of demotions               */
+  unsigned long demotedProcs;    /* summed number of processes
+                                    affected                          */
+  unsigned long demoteUsec;      /* summed time taken to demote       */
+  unsigned long restoreUsec;     /* summed time taken to restore      */
+  unsigned long restoreFailures; /* threads or cgroup files that
+                                    couldn't be restored              */
+  unsigned long reclaims;        /* memory reclaims done              */
+  unsigned long reclaimsStopped; /* same, cut short by activity      */
+  unsigned long reclaimedPages;  /* pages reclaimed                   */
+  unsigned long reclaimUsec;     /* time spent reclaiming             */
+  unsigned long reclaimFailures; /* processes we weren't allowed to
+                                    touch                             */
+} sessionStats;
+
+extern sessionStats sessionStatistics;
+
+extern Bool hasSysNice (void);
+extern Bool canRestoreNice (int nice);
+extern void findServer (Display* d);
+extern Bool cgroupHoldsUs (const char* dir);
+extern void sessionLocked (void);
+extern void sessionUnlocked (void);
+extern void sessionActivity (void);
+extern Bool sessionWatched (void);
+extern void freezeSession (void);
+extern void checkSession (void);
+extern void reclaimSession (void);
+extern void reportSessionStats (void);
+
+#endif /* __session_h */
@@ -0,0 +1,47 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It declares
+ *          the stuff used to spread locker starts across instances.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#ifndef __stagger_h
+#define __stagger_h
+
+#include "config.h"
+#include "timer.h"
+
+#if defined (__GNUC__) && !defined (VMS)
+#define HasStagger
+#endif /* __GNUC__ && !VMS */
+
+typedef struct
+{
+  unsigned long launches;   /* lockers started by us            */
+  unsigned long deferrals;  /* times we held back               */
+  unsigned long staggered;  /* launches held back at least once */
+  unsigned long capped;     /* same, but out of time to wait    */
+  msecs         delayed;    /* summed delay of those launches   */
+  msecs         maxDelayed; /* longest delay of a launch        */
+} staggerStats;
+
+extern staggerStats staggerStatistics;
+
+extern void openStagger (void);
+extern Bool staggerLaunch (msecs now);
+extern void reportStaggerStats (void);
+
+#endif /* __stagger_h */
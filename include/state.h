@@ -22,6 +22,8 @@
 #define __state_h
 
 #include "config.h"
+#include "timer.h"
+#include "trace.h"
 
 extern const char*           progName;
 extern char**                argArray;
@@ -29,19 +31,19 @@ extern unsigned              nofArgs;
 extern Bool                  disabled;
 extern Bool                  lockNow;
 extern Bool                  unlockNow;
-extern time_t                lockTrigger;
-extern time_t                killTrigger;
 extern pid_t                 lockerPid;
 extern volatile sig_atomic_t exitNow;
 extern Bool                  restart;
 
-#define setLockTrigger(delta) (lockTrigger = time ((time_t*) 0) + (delta))
-#define setKillTrigger(delta) (killTrigger = time ((time_t*) 0) + (delta))
-#define disableKillTrigger()  (killTrigger = 0)
-#define resetLockTrigger()    setLockTrigger (lockTime);
-#define resetTriggers()       setLockTrigger (lockTime);                   \
-                              if (killTrigger) setKillTrigger (killTime);  \
+#define resetLockTrigger()    setLockTrigger (lockTime)
+#define disableKillTrigger()  (disarmTimer (tm_kill), trace (tr_killTrigger, -1, 0))
+#define killTriggerSet()      timerArmed (tm_kill)
 
-extern void initState (int argc, char* argv[]);
+extern void  initState (int argc, char* argv[]);
+extern void  setLockTrigger (time_t delta);
+extern void  setKillTrigger (time_t delta);
+extern void  setCornerTrigger (time_t delta, Bool redelay);
+extern void  resetTriggers (void);
+extern msecs lockDeadline (void);
 
 #endif /* __state_h */
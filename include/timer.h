@@ -0,0 +1,54 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It declares
+ *          the timers everything else is driven by.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#ifndef __timer_h
+#define __timer_h
+
+#include "config.h"
+
+typedef long long msecs; /* milliseconds on the CLOCK_BOOTTIME scale */
+
+typedef enum
+{
+  tm_lock,       /* start the locker                         */
+  tm_kill,       /* run the killer                           */
+  tm_notify,     /* notify the user of the upcoming lock     */
+  tm_corner,     /* pointer has been sitting in a `+' corner */
+  tm_redelay,    /* same, right after the locker exited      */
+  tm_poll,       /* time to check for user activity again    */
+  tm_latency,    /* time to check whether the locker locked  */
+  tm_reclaim,    /* page out more of a locked session        */
+  tm_pressure,   /* memory pressure may have eased           */
+  tm_session,    /* see whether a freeze or thaw took effect */
+  tm_prespawn,   /* get the locker ready                     */
+  tm_count       /* number of the above                      */
+} timerId;
+
+extern const char* timerNames[tm_count];
+
+extern msecs monotonicNow (void);
+extern void  armTimer (timerId timer, msecs deadline);
+extern void  disarmTimer (timerId timer);
+extern Bool  timerArmed (timerId timer);
+extern msecs timerDeadline (timerId timer);
+extern Bool  timerExpired (timerId timer, msecs now);
+extern msecs nextDeadline (msecs now);
+
+#endif /* __timer_h */
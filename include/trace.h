@@ -0,0 +1,108 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It declares
+ *          the flight recorder. Also used by tools/tracedump.c, so the
+ *          record layout had better not change without bumping
+ *          TRACE_VERSION.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#ifndef __trace_h
+#define __trace_h
+
+#include "config.h"
+
+#define TRACE_MAGIC   "XATR"
+#define TRACE_VERSION 1
+
+typedef enum
+{
+  tr_none,         /* unused slot                               */
+  tr_lockTrigger,  /* lock timer set,   arg1 = seconds          */
+  tr_killTrigger,  /* kill timer set,   arg1 = seconds, -1: off */
+  tr_corner,       /* pointer in corner, arg1 = seconds,
+                                         arg2 = redelay         */
+  tr_activity,     /* triggers reset by activity or messages    */
+  tr_spawn,        /* command started,  arg1 = command, 
+                                         arg2 = pid             */
+  tr_spawnFailed,  /* command not started, arg1 = command,
+                                           arg2 = errno         */
+  tr_lockerExit,   /* locker gone,      arg1 = pid (0: built-in),
+                                         arg2 = exit status,
+                                                -1: crashed     */
+  tr_message,      /* message handled,  arg1 = message,
+                                         arg2 = response        */
+  tr_xError,       /* X error ignored,  arg1 = error code,
+                                         arg2 = request code    */
+  tr_resume,       /* back from suspend, arg1 = msecs asleep    */
+  tr_clockStep,    /* wall clock set                            */
+  tr_locked,       /* locker got the screen, arg1 = lockKind,
+                                         arg2 = msecs late      */
+  tr_freeze,       /* session frozen,   arg1 = processes,
+                                                -1: cgroup,
+                                         arg2 = usecs taken,
+                                                -1: unconfirmed */
+  tr_thaw,         /* session thawed,   arg1 = msecs frozen,
+                                         arg2 = usecs taken,
+                                                -1: unconfirmed */
+  tr_demote,       /* session demoted,  arg1 = processes,
+                                         arg2 = usecs taken     */
+  tr_restore,      /* session restored, arg1 = processes,
+                                         arg2 = usecs taken,
+                                                -1: incomplete  */
+  tr_reclaim,      /* memory reclaimed, arg1 = pages,
+                                         arg2 = msecs taken,
+                                                -1: cut short   */
+  tr_pressure,     /* new pressure,     arg1 = level,
+                                         arg2 = kill secs       */
+  tr_stagger,      /* locker held back, arg1 = launches seen,
+                                         arg2 = msecs           */
+  tr_prespawn,     /* prespawned locker, arg1 = stage,
+                                         arg2 = pid             */
+  tr_count         /* number of the above                       */
+} traceType;
+
+/*
+ *  Identical records in a row are folded into one, with a repeat
+ *  count. Otherwise things like the lock timer being reset once per
+ *  second while the user is busy would flush out everything else.
+ */
+typedef struct
+{
+  long long stamp;   /* CLOCK_MONOTONIC_COARSE, nanoseconds */
+  long long arg1;    /* as it says                          */
+  long long arg2;    /* as it says                          */
+  int       type;    /* a traceType                         */
+  int       repeats; /* number of identical ones folded in  */
+} traceRecord;
+
+typedef struct
+{
+  char      magic[4];    /* TRACE_MAGIC                        */
+  int       version;     /* TRACE_VERSION                      */
+  int       recordSize;  /* sizeof (traceRecord)               */
+  int       nofRecords;  /* number of records in the ring      */
+  long long next;        /* number of records ever written     */
+  long long stamp;       /* CLOCK_MONOTONIC_COARSE at dump     */
+  long long wallClock;   /* time () at dump                    */
+  long long pid;         /* as it says                         */
+} traceHeader;
+
+extern void trace (traceType type, long long arg1, long long arg2);
+extern void initTrace (void);
+extern Bool dumpTrace (void);
+
+#endif /* __trace_h */
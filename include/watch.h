@@ -0,0 +1,39 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It declares
+ *          the stuff used to have the main loop wait for file descriptors
+ *          other than the X connection.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#ifndef __watch_h
+#define __watch_h
+
+#include "config.h"
+
+/*
+ *  Watch handlers get called whenever their file descriptor becomes
+ *  readable. If the return value is True then control returns to the
+ *  main loop immediately instead of waiting for more events.
+ */
+typedef Bool (*watchHandler) (Display* d, int fd);
+
+extern Bool addWatch (int fd, watchHandler handler);
+extern void removeWatch (int fd);
+extern int  setWatches (fd_set* fds, int maxFd);
+extern Bool handleWatches (Display* d, fd_set* fds);
+
+#endif /* __watch_h */
@@ -0,0 +1,196 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          the stuff used to notice suspends and clock changes.
+ *
+ *          CLOCK_MONOTONIC stands still while the machine is suspended,
+ *          CLOCK_BOOTTIME doesn't. So the difference between them grows
+ *          by exactly the time spent suspended, and by nothing else. To
+ *          learn when to look, we keep a timerfd with the cancel-on-set
+ *          flag around: the kernel cancels it whenever the wall clock
+ *          is set, which includes it jumping ahead on resume.
+ *
+ *          Where that's not available, -detectsleep falls back on the
+ *          old trick of checking whether the wall clock jumped more than
+ *          3 seconds between two main loop iterations. That can't tell
+ *          a suspend from the clock being set, so it only ever resets
+ *          the lock trigger, and the timers are left alone otherwise.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "clocks.h"
+#include "options.h"
+#include "state.h"
+#include "watch.h"
+#include "trace.h"
+#include "miscutil.h"
+
+#include <errno.h>
+#include <limits.h>
+
+clockStats clockStatistics; /* as it says */
+
+#ifdef TFD_TIMER_CANCEL_ON_SET
+static int   clockFd = -1; /* the timerfd, or -1          */
+static msecs bootOffset;   /* CLOCK_BOOTTIME - monotonic  */
+
+/*
+ *  Function for reading how far CLOCK_BOOTTIME is ahead of
+ *  CLOCK_MONOTONIC.
+ */
+static msecs
+readBootOffset (void)
+{
+  struct timespec mono; /* as it says */
+  struct timespec boot; /* as it says */
+
+  (void) clock_gettime (CLOCK_MONOTONIC, &mono);
+  (void) clock_gettime (CLOCK_BOOTTIME, &boot);
+
+  return   (msecs) (boot.tv_sec - mono.tv_sec) * 1000
+         + (boot.tv_nsec - mono.tv_nsec) / 1000000;
+}
+
+/*
+ *  Function for (re)arming the timerfd. It is set to expire in the
+ *  far future, as all we're after is it getting cancelled.
+ */
+static Bool
+armClockFd (void)
+{
+  struct itimerspec never;
+
+  (void) memset (&never, 0, sizeof (never));
+  never.it_value.tv_sec = (time_t) LONG_MAX;
+
+  return !timerfd_settime (clockFd,
+                           TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+                           &never, 0);
+}
+
+/*
+ *  Watch handler.
+ */
+static Bool
+clocksChanged (Display* d, int fd)
+{
+  unsigned long long expirations; /* as it says      */
+  msecs              offset;      /* as it says      */
+  msecs              slept;       /* time suspended  */
+
+  if (read (fd, &expirations, sizeof (expirations)) >= 0 || errno != ECANCELED)
+  {
+    return False;
+  }
+
+  offset = readBootOffset ();
+  slept = offset - bootOffset;
+  bootOffset = offset;
+
+  if (slept >= MIN_SUSPEND)
+  {
+    ++clockStatistics.resumes;
+    clockStatistics.suspended += slept;
+    clockStatistics.lastSuspended = slept;
+    trace (tr_resume, slept, 0);
+
+   /*
+    *  The timers run on CLOCK_BOOTTIME here, so they kept going
+    *  while we were away, and whatever fell due in the meantime goes
+    *  off right now. Unless asked to start over instead.
+    */
+    if (detectSleep) resetLockTrigger ();
+  }
+  else
+  {
+    ++clockStatistics.steps;
+    trace (tr_clockStep, 0, 0);
+  }
+
+  (void) armClockFd ();
+  return True;
+}
+#endif /* TFD_TIMER_CANCEL_ON_SET */
+
+/*
+ *  Function for setting things up.
+ */
+void
+watchClocks (void)
+{
+#ifdef TFD_TIMER_CANCEL_ON_SET
+  if ((clockFd = timerfd_create (CLOCK_REALTIME, TFD_CLOEXEC | TFD_NONBLOCK)) < 0)
+  {
+    return;
+  }
+
+  bootOffset = readBootOffset ();
+
+  if (!armClockFd () || !addWatch (clockFd, clocksChanged))
+  {
+    (void) close (clockFd);
+    clockFd = -1;
+  }
+#endif /* TFD_TIMER_CANCEL_ON_SET */
+}
+
+/*
+ *  Fallback for when the above doesn't work, only used with
+ *  -detectsleep. To be called once per main loop iteration, before
+ *  the triggers get looked at.
+ */
+void
+checkClocks (void)
+{
+  static time_t prev = 0; /* as it says */
+  time_t        now;      /* as it says */
+
+#ifdef TFD_TIMER_CANCEL_ON_SET
+  if (clockFd >= 0) return;
+#endif /* TFD_TIMER_CANCEL_ON_SET */
+
+  now = time ((time_t*) 0);
+
+ /*
+  *  A gap this large may just as well be the clock being set, so
+  *  all we dare do is start over. Moving deadlines forward would
+  *  have the locker go off on a mere clock change.
+  */
+  if (prev && (unsigned long) now - (unsigned long) prev > 3)
+  {
+    ++clockStatistics.resumes;
+    trace (tr_resume, (now - prev) * 1000, 0);
+    resetLockTrigger ();
+  }
+
+  prev = now;
+}
+
+/*
+ *  Function for telling the user about the clocks.
+ */
+void
+reportClockStats (void)
+{
+  if (clockStatistics.resumes || clockStatistics.steps)
+  {
+    (void) fprintf (stderr,
+                    "clocks    : %lu resumes, %lld ms suspended, %lld ms "
+                    "last time, %lu clock changes.\n",
+                    clockStatistics.resumes, clockStatistics.suspended,
+                    clockStatistics.lastSuspended, clockStatistics.steps);
+  }
+}
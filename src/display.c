@@ -0,0 +1,207 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          the real display layer, i.e. the one that talks to an actual
+ *          X server and runs actual lockers.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "display.h"
+#include "miscutil.h"
+
+/*
+ *  CLOCK_BOOTTIME keeps going while the machine is suspended, so that
+ *  a lock that fell due in the meantime happens the moment it resumes.
+ */
+#ifdef CLOCK_BOOTTIME
+#define TIMER_CLOCK CLOCK_BOOTTIME
+#else /* CLOCK_BOOTTIME */
+#define TIMER_CLOCK CLOCK_MONOTONIC
+#endif /* CLOCK_BOOTTIME */
+
+static msecs
+xlibNow (void)
+{
+  struct timespec now;
+
+  (void) clock_gettime (TIMER_CLOCK, &now);
+  return (msecs) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static int
+xlibWait (int nfds, fd_set* fds, struct timeval* timeout)
+{
+  return select (nfds, fds, (fd_set*) 0, (fd_set*) 0, timeout);
+}
+
+static Time
+xlibQueryIdle (Display* d, Bool useXidle)
+{
+  Time idleTime = 0; /* millisecs since last input event */
+
+#ifdef HasXidle
+  if (useXidle)
+  {
+    XGetIdleTime (d, &idleTime);
+  }
+  else
+#endif /* HasXIdle */
+  {
+#ifdef HasScreenSaver
+    static XScreenSaverInfo* mitInfo = 0; 
+    if (!mitInfo) mitInfo = XScreenSaverAllocInfo ();
+    XScreenSaverQueryInfo (d, DefaultRootWindow (d), mitInfo);
+    idleTime = mitInfo->idle;
+#endif /* HasScreenSaver */
+  }
+
+  return idleTime;
+}
+
+static void
+xlibQueryPointer (Display* d, int* x, int* y, unsigned* mask,
+                  Screen** screen)
+{
+  Window           dummyWin;         /* as it says                    */
+  int              dummyInt;         /* as it says                    */
+  int              i;                /* loop counter                  */
+  static Window    root;             /* root window the pointer is on */
+  static Screen*   current;          /* screen the pointer is on      */
+  static Bool      firstCall = True; /* as it says                    */
+
+ /*
+  *  Have a guess...
+  */
+  if (firstCall)
+  {
+    firstCall = False;
+    root = DefaultRootWindow (d);
+    current = ScreenOfDisplay (d, DefaultScreen (d));
+  }
+
+  if (!XQueryPointer (d, root, &root, &dummyWin, x, y,
+                      &dummyInt, &dummyInt, mask))
+  {
+   /*
+    *  Pointer has moved to another screen, so let's find out which one.
+    */
+    for (i = -1; ++i < ScreenCount (d); ) 
+    {
+      if (root == RootWindow (d, i)) 
+      {
+        current = ScreenOfDisplay (d, i);
+        break;
+      }
+    }
+  }
+
+  *screen = current;
+}
+
+static int
+xlibPending (Display* d)
+{
+  return XPending (d);
+}
+
+static void
+xlibNextEvent (Display* d, XEvent* event)
+{
+  (void) XNextEvent (d, event);
+}
+
+static Bool
+xlibCheckMaskEvent (Display* d, long mask, XEvent* event)
+{
+  return XCheckMaskEvent (d, mask, event);
+}
+
+static Status
+xlibSendEvent (Display* d, Window w, XEvent* event)
+{
+  return XSendEvent (d, w, False, 0, event);
+}
+
+static void
+xlibSync (Display* d)
+{
+  (void) XSync (d, 0);
+}
+
+static void
+xlibBell (Display* d, int percent)
+{
+  (void) XBell (d, percent);
+  (void) XSync (d, 0);
+}
+
+static void
+xlibSelectInput (Display* d, Window w, long mask)
+{
+  (void) XSelectInput (d, w, mask);
+}
+
+static Status
+xlibGetAttributes (Display* d, Window w, XWindowAttributes* attribs)
+{
+  return XGetWindowAttributes (d, w, attribs);
+}
+
+static pid_t
+xlibLaunchLocker (commandType type)
+{
+  return launchCommand (type, -1, -1);
+}
+
+static pid_t
+xlibReapLocker (pid_t pid, int* status)
+{
+#ifndef VMS
+#if !defined (UTEKV) && !defined (SYSV) && !defined (SVR4)
+  union wait  wstatus;  /* childs process status */
+  pid_t       got;      /* as it says            */
+
+  got = wait4 (pid, &wstatus, WNOHANG, 0);
+  *status = wstatus.w_status;
+  return got;
+#else /* !UTEKV && !SYSV && !SVR4 */
+  return waitpid (pid, status, WNOHANG);
+#endif /* !UTEKV && !SYSV && !SVR4 */
+#else /* VMS */
+  return 0;
+#endif /* VMS */
+}
+
+const displayOps xlibOps =
+{
+  "xlib",
+  xlibNow,
+  xlibWait,
+  xlibQueryIdle,
+  xlibQueryPointer,
+  xlibPending,
+  xlibNextEvent,
+  xlibCheckMaskEvent,
+  xlibSendEvent,
+  xlibSync,
+  xlibBell,
+  xlibSelectInput,
+  xlibGetAttributes,
+  xlibLaunchLocker,
+  xlibReapLocker
+};
+
+const displayOps* dpy = &xlibOps;
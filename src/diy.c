@@ -31,6 +31,11 @@
 #include "diy.h"
 #include "state.h"
 #include "options.h"
+#include "lock.h"
+#include "metrics.h"
+#include "latency.h"
+#include "display.h"
+#include "probes.h"
 #include "miscutil.h"
 
 static void selectEvents (Window window, Bool substructureOnly);
@@ -41,7 +46,7 @@ static void selectEvents (Window window, Bool substructureOnly);
 typedef struct item
 {
   Window       window;
-  time_t       creationtime;
+  msecs        creationtime;
   struct item* next;
 } anItem, *item;
 
@@ -58,22 +63,26 @@ addToQueue (Window window)
   item newItem = newObj (anItem);
 
   newItem->window = window;
-  newItem->creationtime = time (0);
+  newItem->creationtime = monotonicNow ();
   newItem->next = 0;
 
   if (!queue.head) queue.head = newItem;
   if ( queue.tail) queue.tail->next = newItem;
 
   queue.tail = newItem;
+  ++metrics.diyQueueDepth;
 }
 
 static void
-processQueue (time_t age)
+processQueue (msecs age)
 {
   if (queue.head)
   {
-    time_t now = time (0);
+    msecs now = monotonicNow ();
     item current = queue.head;
+    countRequestsFrom (queue.display);
+
+    PROBE1 (process_queue__start, metrics.diyQueueDepth);
 
     while (current && current->creationtime + age < now)
     {
@@ -81,9 +90,12 @@ processQueue (time_t age)
       queue.head = current->next;
       free (current);
       current = queue.head;
+      --metrics.diyQueueDepth;
     }
 
     if (!queue.head) queue.tail = 0;
+    countRequestsTo (queue.display, xs_diy);
+    PROBE1 (process_queue__done, metrics.diyQueueDepth);
   }
 }
 
@@ -101,9 +113,13 @@ selectEvents (Window window, Bool substructureOnly)
   unsigned          i;                 /* loop counter              */
   XWindowAttributes attribs;           /* attributes of the window  */
 
+  PROBE2 (select_events, window, substructureOnly);
+
  /*
   *  Start by querying the server about the root and parent windows.
   */
+  countRoundTrip (xs_diy);
+
   if (!XQueryTree (queue.display, window, &root, &parent,
                    &children, &nofChildren))
   {
@@ -134,9 +150,10 @@ selectEvents (Window window, Bool substructureOnly)
       attribs.all_event_masks = 
       attribs.do_not_propagate_mask = KeyPressMask;
     }
-    else if (!XGetWindowAttributes (queue.display, window, &attribs))
+    else
     {
-      return;
+      countRoundTrip (xs_diy);
+      if (!XGetWindowAttributes (queue.display, window, &attribs)) return;
     }
 
     (void) XSelectInput (queue.display, window, 
@@ -157,6 +174,8 @@ selectEvents (Window window, Bool substructureOnly)
   *  XGrabServer(), but that'd be an impolite thing to do, and since it
   *  isn't required...
   */
+  countRoundTrip (xs_diy);
+
   if (!XQueryTree (queue.display, window, &root, &parent,
                    &children, &nofChildren))
   {
@@ -182,11 +201,11 @@ selectEvents (Window window, Bool substructureOnly)
 void
 processEvents (void)
 {
-  while (XPending (queue.display))
+  while (dpy->pending (queue.display))
   {
     XEvent event;
 
-    if (XCheckMaskEvent (queue.display, SubstructureNotifyMask, &event))
+    if (dpy->checkMaskEvent (queue.display, SubstructureNotifyMask, &event))
     {
       if (event.type == CreateNotify)
       {
@@ -195,9 +214,12 @@ processEvents (void)
     }
     else
     {
-      (void) XNextEvent (queue.display, &event);
+      dpy->nextEvent (queue.display, &event);
+      (void) handleLockEvent (queue.display, &event);
     }
 
+    handleLatencyEvent (queue.display, &event);
+
    /*
     *  Reset the triggers if and only if the event is a
     *  KeyPress event *and* was not generated by XSendEvent().
@@ -205,7 +227,9 @@ processEvents (void)
     if (   event.type == KeyPress
         && !event.xany.send_event)
     {
+      PROBE2 (reset_triggers, rs_key, event.xkey.window);
       resetTriggers ();
+      metrics.lastActivity = monotonicNow ();
     }
   }
 
@@ -213,7 +237,7 @@ processEvents (void)
   *  Check the window queue for entries that are older than
   *  CREATION_DELAY seconds.
   */
-  processQueue ((time_t) CREATION_DELAY);
+  processQueue ((msecs) CREATION_DELAY * 1000);
 }
 
 /*
@@ -223,6 +247,7 @@ void
 initDiy (Display* d)
 {
   int s;
+  countRequestsFrom (d);
 
   queue.display = d;
   queue.tail = 0;
@@ -234,4 +259,6 @@ initDiy (Display* d)
     addToQueue (root);
     selectEvents (root, True);
   }
+
+  countRequestsTo (d, xs_diy);
 }
@@ -21,38 +21,111 @@
 #include "engine.h"
 #include "options.h"
 #include "state.h"
+#include "launch.h"
+#include "hook.h"
+#include "lock.h"
+#include "watch.h"
+#include "metrics.h"
+#include "latency.h"
+#include "session.h"
+#include "pressure.h"
+#include "stagger.h"
+#include "prespawn.h"
+#include "display.h"
+#include "trace.h"
+#include "probes.h"
 #include "miscutil.h"
 
 /*
- *  Function for querying the idle time from the server.
- *  Only used if either the Xidle or the Xscreensaver
- *  extension is present.
+ *  -roundtrips support. Looking at the user costs a round trip for the
+ *  idle time unless in DIY mode, plus one for the pointer unless the
+ *  idle time already covers that. Looks get spaced out evenly so as to
+ *  stay within budget. In between, whatever was seen last time stands.
  */
-void 
-queryIdleTime (Display* d, Bool use_xidle)
+static msecs lastLook = 0; /* when the user was last looked at */
+static msecs nextLook = 0; /* when that may be done again      */
+
+Bool
+pointerNeeded (Bool diy)
+{
+  return    diy
+         || !maxRoundTrips
+         || corners[0] != ca_ignore || corners[1] != ca_ignore
+         || corners[2] != ca_ignore || corners[3] != ca_ignore;
+}
+
+Bool
+lookAtUser (Bool diy)
 {
-  Time idleTime = 0; /* millisecs since last input event */
+  msecs now = monotonicNow ();
+  int   trips = (diy ? 0 : 1) + (pointerNeeded (diy) ? 1 : 0);
 
-#ifdef HasXidle
-  if (use_xidle)
+  if (maxRoundTrips)
   {
-    XGetIdleTime (d, &idleTime);
+    if (now < nextLook) return False;
+    nextLook = now + trips * 60000 / maxRoundTrips;
   }
-  else
-#endif /* HasXIdle */
+
+  lastLook = now;
+  return True;
+}
+
+/*
+ *  Function for not acting on a deadline that passed since the user
+ *  was last looked at. It gets postponed until the next look, which
+ *  will either reset it or confirm it.
+ */
+static void
+holdStaleTriggers (msecs now)
+{
+  int t; /* loop counter */
+
+  for (t = tm_lock - 1; ++t <= tm_redelay; )
   {
-#ifdef HasScreenSaver
-    static XScreenSaverInfo* mitInfo = 0; 
-    if (!mitInfo) mitInfo = XScreenSaverAllocInfo ();
-    XScreenSaverQueryInfo (d, DefaultRootWindow (d), mitInfo);
-    idleTime = mitInfo->idle;
-#endif /* HasScreenSaver */
+    if (   timerExpired (t, now)
+        && timerDeadline (t) > lastLook)
+    {
+      armTimer (t, nextLook);
+    }
   }
+}
+
+/*
+ *  Function for querying the idle time from the server.
+ *  Only used if either the Xidle or the Xscreensaver
+ *  extension is present.
+ */
+void 
+queryIdleTime (Display* d, Bool useXidle)
+{
+  Time         idleTime;      /* millisecs since last input event */
+  msecs        now;           /* as it says                       */
+  static msecs lastQuery = 0; /* as it says                       */
+  countRequestsFrom (d);
+
+  PROBE0 (query_idle__start);
+
+  idleTime = dpy->queryIdle (d, useXidle);
+  countRoundTrip (xs_idle);
 
-  if (idleTime < 1000)  
+  countRequestsTo (d, xs_idle);
+  now = monotonicNow ();
+  metrics.lastActivity = now - (msecs) idleTime;
+
+ /*
+  *  Normally, this gets called every second. If not, because of
+  *  -roundtrips or because nothing needed watching for a while, any
+  *  activity since the previous call counts.
+  */
+  if (   idleTime < 1000
+      || (lastQuery && (msecs) idleTime < now - lastQuery))
   {
+    PROBE2 (reset_triggers, rs_idle, idleTime);
     resetTriggers ();
   }
+
+  lastQuery = now;
+  PROBE1 (query_idle__done, idleTime);
 }
 
 /*
@@ -65,52 +138,25 @@ queryIdleTime (Display* d, Bool use_xidle)
 void 
 queryPointer (Display* d)
 {
-  Window           dummyWin;         /* as it says                    */
-  int              dummyInt;         /* as it says                    */
   unsigned         mask;             /* modifier mask                 */
   int              rootX;            /* as it says                    */
   int              rootY;            /* as it says                    */
   int              corner;           /* corner index                  */
-  time_t           now;              /* as it says                    */
-  time_t           newTrigger;       /* temporary storage             */
-  int              i;                /* loop counter                  */
-  static Window    root;             /* root window the pointer is on */
-  static Screen*   screen;           /* screen the pointer is on      */
+  Screen*          screen;           /* screen the pointer is on      */
   static unsigned  prevMask = 0;     /* as it says                    */
   static int       prevRootX = -1;   /* as it says                    */
   static int       prevRootY = -1;   /* as it says                    */
-  static Bool      firstCall = True; /* as it says                    */
+  countRequestsFrom (d);
 
- /*
-  *  Have a guess...
-  */
-  if (firstCall)
-  {
-    firstCall = False;
-    root = DefaultRootWindow (d);
-    screen = ScreenOfDisplay (d, DefaultScreen (d));
-  }
+  PROBE0 (query_pointer__start);
 
  /*
   *  Find out whether the pointer has moved. Using XQueryPointer for this
   *  is gross, but it also is the only way never to mess up propagation
   *  of pointer events.
   */
-  if (!XQueryPointer (d, root, &root, &dummyWin, &rootX, &rootY,
-                      &dummyInt, &dummyInt, &mask))
-  {
-   /*
-    *  Pointer has moved to another screen, so let's find out which one.
-    */
-    for (i = -1; ++i < ScreenCount (d); ) 
-    {
-      if (root == RootWindow (d, i)) 
-      {
-        screen = ScreenOfDisplay (d, i);
-        break;
-      }
-    }
-  }
+  countRoundTrip (xs_pointer);
+  dpy->queryPointer (d, &rootX, &rootY, &mask, &screen);
 
   if (   rootX == prevRootX
       && rootY == prevRootY
@@ -141,20 +187,19 @@ queryPointer (Display* d)
                rootX >= WidthOfScreen  (screen) - cornerSize - 1
             && rootY >= HeightOfScreen (screen) - cornerSize - 1))
     {
-      now = time (0);
-
       switch (corners[corner])
       {
+       /*
+        *  The pointer already got here a poll interval ago, hence
+        *  the one second less.
+        */
         case ca_forceLock:
-          newTrigger = now + (useRedelay ? cornerRedelay : cornerDelay) - 1;
-
-          if (newTrigger < lockTrigger)
-          {
-            setLockTrigger (newTrigger - now);
-          }
+          setCornerTrigger ((useRedelay ? cornerRedelay : cornerDelay) - 1,
+                            useRedelay);
           break;
 
         case ca_dontLock:
+          PROBE2 (reset_triggers, rs_corner, corner);
           resetTriggers ();
 
 #ifdef __GNUC__
@@ -170,8 +215,199 @@ queryPointer (Display* d)
     prevRootY = rootY;
     prevMask = mask;
 
+    PROBE2 (reset_triggers, rs_pointer, 0);
     resetTriggers ();
+    metrics.lastActivity = monotonicNow ();
   }
+
+  countRequestsTo (d, xs_pointer);
+  PROBE2 (query_pointer__done, rootX, rootY);
+}
+
+/*
+ *  Locker tracking support. Where available, we get a pidfd for the
+ *  locker and have the main loop wait on it, so that we learn about 
+ *  the locker exiting the very moment it happens. Otherwise we have
+ *  to make do with checking once per main loop iteration.
+ */
+#ifndef VMS
+static int lockerFd = -1; /* pidfd of the locker, if any */
+
+static Bool
+lockerExited (Display* d, int fd)
+{
+  (void) checkLocker ();
+  return True;
+}
+
+static void
+trackLocker (void)
+{
+#ifdef SYS_pidfd_open
+  if ((lockerFd = syscall (SYS_pidfd_open, lockerPid, 0)) >= 0) /* = intended */
+  {
+    (void) fcntl (lockerFd, F_SETFD, FD_CLOEXEC);
+
+    if (!addWatch (lockerFd, lockerExited))
+    {
+      (void) close (lockerFd);
+      lockerFd = -1;
+    }
+  }
+#endif /* SYS_pidfd_open */
+}
+
+static void
+untrackLocker (void)
+{
+  if (lockerFd >= 0)
+  {
+    removeWatch (lockerFd);
+    (void) close (lockerFd);
+    lockerFd = -1;
+  }
+}
+#endif /* VMS */
+
+/*
+ *  Function for telling whether the main loop will be woken up as
+ *  soon as the locker exits, i.e. whether it can afford to sleep
+ *  for as long as the locker is running.
+ */
+Bool
+lockerTracked (void)
+{
+#ifndef VMS
+  return lockerFd >= 0;
+#else /* VMS */
+  return False;
+#endif /* VMS */
+}
+
+/*
+ *  Function for waiting for (or killing, if we were so told) an
+ *  external locker. Returns True if there was one around.
+ */
+static Bool
+checkExternalLocker (void)
+{
+#ifdef VMS
+  if (vmsStatus != 0) return False;
+#else /* VMS */
+  int status = 0; /* childs process status */
+
+  if (!lockerPid) 
+  {
+    unlockNow = False;
+    return False;
+  }
+
+  if (unlockNow && !disabled)
+  {
+    (void) kill (lockerPid, SIGTERM);
+  }
+
+  unlockNow = False;
+
+ /*
+  *  Only ever wait for the locker itself. The notifier and the
+  *  killer are our children too, but checkHooks() takes care
+  *  of those.
+  */
+  if (dpy->reapLocker (lockerPid, &status))
+  {
+   /*
+    *  If the locker exited normally, we disable any pending kill
+    *  trigger. Otherwise, we assume that it either has crashed or
+    *  was not able to lock the display because of an existing
+    *  locker (which may have been started manually). In both of
+    *  the later cases, disabling the kill trigger would open a
+    *  loop hole.
+    */
+    if (   WIFEXITED (status)
+        && WEXITSTATUS (status) == EXIT_SUCCESS)
+    {
+      disableKillTrigger ();
+    }
+
+    trace (tr_lockerExit, lockerPid,
+           WIFEXITED (status) ? WEXITSTATUS (status) : -1);
+    sessionUnlocked ();
+    abandonLockLatency ();
+    untrackLocker ();
+    useRedelay = True;
+    lockerPid = 0;
+  }
+#endif /* VMS */
+
+  setLockTrigger (lockTime);
+  return True;
+}
+
+/*
+ *  Function for keeping track of the locker, built-in or not.
+ *  Returns True if there is one around.
+ */
+Bool
+checkLocker (void)
+{
+  if (!screenLocked ()) return checkExternalLocker ();
+
+  if (unlockNow && !disabled)
+  {
+    unlockScreen ();
+  }
+  else
+  {
+    checkLock ();
+  }
+
+  unlockNow = False;
+  setLockTrigger (lockTime);
+  return True;
+}
+
+/*
+ *  Things to do right after the locker has been started.
+ */
+static void
+lockerStarted (Display* d)
+{
+ /*
+  *  In general xautolock should keep its fingers off the real
+  *  screensaver because no universally acceptable policy can 
+  *  be defined. In no case should it decide to disable or enable 
+  *  it all by itself. Setting the screensaver policy is something
+  *  the locker should take care of. After all, xautolock is not
+  *  supposed to know what the "locker" does and doesn't do. 
+  *  People might be using xautolock for totally different
+  *  purposes (which, by the way, is why it will accept a
+  *  different set of X resources after being renamed).
+  *
+  *  Nevertheless, simply resetting the screensaver is a
+  *  convenience action that aids many xlock users, and doesn't
+  *  harm anyone (*). The problem with older versions of xlock 
+  *  is that they can be told to replace (= disable) the real
+  *  screensaver, but forget to reset that same screensaver if
+  *  it was already active at the time xlock starts. I guess 
+  *  xlock initially wasn't designed to be run without a user
+  *  actually typing the comand ;-).
+  *
+  *  (*) Well, at least it used not to harm anyone, but with the
+  *      advent of DPMS monitors, it now can mess up the power
+  *      saving setup. Hence we better make it optional. 
+  *
+  *      Also, some xlock versions also unconditionally call
+  *      XResetScreenSaver, yielding the same kind of problems
+  *      with DPMS that xautolock did. The latest and greatest
+  *      xlocks also have a -resetsaver option for this very
+  *      reason. You may want to upgrade.
+  */
+  if (resetSaver) (void) XResetScreenSaver(d);
+
+  sessionLocked ();
+  setLockTrigger (lockTime);
+  dpy->sync (d);
 }
 
 /*
@@ -180,8 +416,9 @@ queryPointer (Display* d)
 void
 evaluateTriggers (Display* d)
 {
-  static time_t prevNotification = 0;
-  time_t        now = 0;
+  msecs now = 0;
+
+  PROBE0 (evaluate__start);
 
  /*
   *  Obvious things first.
@@ -193,6 +430,7 @@ evaluateTriggers (Display* d)
   */
   if (disabled)
   {
+    PROBE2 (reset_triggers, rs_disabled, 0);
     resetTriggers ();
   }
 
@@ -203,124 +441,102 @@ evaluateTriggers (Display* d)
   *  hanging around until we are re-enabled, but also to prevent
   *  us from incorrectly setting a kill trigger at the moment 
   *  when we are finally re-enabled.
+  *
+  *  No return here if there is one! The pointer may be sitting
+  *  in a corner, while parameter settings may be such that we 
+  *  need to start another locker without further delay. If you
+  *  think this cannot happen, consider the case in which the 
+  *  locker simply crashed.
   */
-#ifdef VMS
-  if (vmsStatus == 0)  
-  {
-#else /* VMS */
-  if (lockerPid)
-  {
-#if !defined (UTEKV) && !defined (SYSV) && !defined (SVR4)
-    union wait  status;      /* childs process status */
-#else /* !UTEKV && !SYSV && !SVR4 */
-    int         status = 0;  /* childs process status */
-#endif /* !UTEKV && !SYSV && !SVR4 */
-
-    if (unlockNow && !disabled)
-    {
-      (void) kill (lockerPid, SIGTERM);
-    }
-
-#if !defined (UTEKV) && !defined (SYSV) && !defined (SVR4)
-    if (wait3 (&status, WNOHANG, 0))
-#else /* !UTEKV && !SYSV && !SVR4 */
-    if (waitpid (-1, &status, WNOHANG)) 
-#endif /* !UTEKV && !SYSV && !SVR4 */
-    {
-     /*
-      *  If the locker exited normally, we disable any pending kill
-      *  trigger. Otherwise, we assume that it either has crashed or
-      *  was not able to lock the display because of an existing
-      *  locker (which may have been started manually). In both of
-      *  the later cases, disabling the kill trigger would open a
-      *  loop hole.
-      */
-      if (   WIFEXITED (status)
-	  && WEXITSTATUS (status) == EXIT_SUCCESS)
-      {
-        disableKillTrigger ();
-      }
-
-      useRedelay = True;
-      lockerPid = 0;
-    }
-#endif /* VMS */
+  (void) checkLocker ();
 
-    setLockTrigger (lockTime);
+  checkHooks ();
+  checkPrespawn ();
+  checkLockLatency (d);
 
-   /*
-    *  No return here! The pointer may be sitting in a corner, while
-    *  parameter settings may be such that we need to start another
-    *  locker without further delay. If you think this cannot happen,
-    *  consider the case in which the locker simply crashed.
-    */
-  }
-
-  unlockNow = False;
+  if (timerExpired (tm_pressure, monotonicNow ())) easePressure ();
+  if (timerExpired (tm_session, monotonicNow ())) checkSession ();
 
  /*
   *  Note that the above lot needs to be done even when we're in 
   *  disabled mode, since we may have entered said mode with an
   *  active locker around. 
   */
-  if (disabled) return;
+  if (disabled)
+  {
+    PROBE0 (evaluate__done);
+    return;
+  }
 
  /*
-  *  Is it time to run the killer command?
+  *  Is it time to run the killer command and/or freeze the session?
   */
-  now = time (0);
+  now = monotonicNow ();
+  if (maxRoundTrips) holdStaleTriggers (now);
 
-  if (killTrigger && now >= killTrigger)
+  if (timerExpired (tm_kill, now))
   {
+    PROBE1 (kill, now - timerDeadline (tm_kill));
+
    /*
-    *  There is a dirty trick here. On the one hand, we don't want
-    *  to block until the killer returns, but on the other one
-    *  we don't want to have it interfere with the wait() stuff we 
-    *  do to keep track of the locker. To obtain both, the killer
-    *  command has already been patched by KillerChecker() so that
-    *  it gets backgrounded by the shell started by system().
-    *
-    *  For the time being, VMS users are out of luck: their xautolock
-    *  will indeed block until the killer returns.
+    *  We don't want to block until the killer returns, nor do we
+    *  want to have it interfere with the wait() stuff we do to keep
+    *  track of the locker. runHook() does not wait for it, and it 
+    *  gets collected whenever it is done.
     */
-    { int dummy; dummy = system (killer); } // Silly gcc...
-    setKillTrigger (killTime);
+    if (killerSpecified) runHook (cmd_killer);
+    freezeSession ();
+    setKillTrigger (killDelay ());
+  }
+
+ /*
+  *  Page out some more of a session that has been locked for a while.
+  */
+  if (timerExpired (tm_reclaim, now)) reclaimSession ();
+
+ /*
+  *  Get the locker going ahead of time if so requested. It waits
+  *  for the word to lock, see below.
+  */
+  if (timerExpired (tm_prespawn, now))
+  {
+    disarmTimer (tm_prespawn);
+    if (!lockerPid && !screenLocked ()) prespawnLocker ();
   }
 
  /*
   *  Now trigger the notifier if required. 
   */
-  if (   notifyLock
-      && now + notifyMargin >= lockTrigger
-      && prevNotification < now - notifyMargin - 1)
+  if (timerExpired (tm_notify, now))
   {
+    PROBE1 (notify, lockDeadline () - now);
+
     if (notifierSpecified)
     {
      /*
-      *  Here we use the same dirty trick as for the killer command.
+      *  Same story as for the killer command.
       */
-      { int dummy; dummy = system (notifier); } // Silly gcc...
+      runHook (cmd_notifier);
     }
     else
     {
-      (void) XBell (d, bellPercent);
-      (void) XSync (d, 0);
+      dpy->bell (d, bellPercent);
     }
 
-    prevNotification = now;
+    disarmTimer (tm_notify);
   }
 
  /*
-  *  Finally fire up the locker if time has somehow come. 
+  *  Finally fire up the locker if time has somehow come, and no
+  *  other instances insist on going first.
   */
   if (   lockNow
-      || now >= lockTrigger)
+      || (now >= lockDeadline () && staggerLaunch (now)))
   {
+    PROBE2 (lock, lockNow, now - lockDeadline ());
+
 #ifdef VMS
     if (vmsStatus != 0)
-#else /* VMS */
-    if (!lockerPid)
-#endif /* VMS */
     {
       switch (lockerPid = vfork ())
       {
@@ -330,7 +546,6 @@ evaluateTriggers (Display* d)
   
         case 0:
           (void) close (ConnectionNumber (d));
-#ifdef VMS
           vmsStatus = 0;
           lockerPid = lib$spawn ((lockNow ? &nowLockerDescr : &lockerDescr),
 	                         0, 0, &1, 0, 0, &vmsStatus);
@@ -340,48 +555,44 @@ evaluateTriggers (Display* d)
 #ifdef SLOW_VMS
           (void) sleep (SLOW_VMS_DELAY); 
 #endif /* SLOW_VMS */
-#else /* VMS */
-          (void) execl ("/bin/sh", "/bin/sh", "-c", 
-	                (lockNow ? nowLocker : locker), (void*) 0);
-#endif /* VMS */
           _exit (EXIT_FAILURE);
   
         default:
-         /*
-          *  In general xautolock should keep its fingers off the real
-          *  screensaver because no universally acceptable policy can 
-          *  be defined. In no case should it decide to disable or enable 
-          *  it all by itself. Setting the screensaver policy is something
-          *  the locker should take care of. After all, xautolock is not
-          *  supposed to know what the "locker" does and doesn't do. 
-          *  People might be using xautolock for totally different
-          *  purposes (which, by the way, is why it will accept a
-          *  different set of X resources after being renamed).
-          *
-          *  Nevertheless, simply resetting the screensaver is a
-          *  convenience action that aids many xlock users, and doesn't
-          *  harm anyone (*). The problem with older versions of xlock 
-	  *  is that they can be told to replace (= disable) the real
-	  *  screensaver, but forget to reset that same screensaver if
-	  *  it was already active at the time xlock starts. I guess 
-	  *  xlock initially wasn't designed to be run without a user
-	  *  actually typing the comand ;-).
-	  *
-	  *  (*) Well, at least it used not to harm anyone, but with the
-	  *      advent of DPMS monitors, it now can mess up the power
-	  *      saving setup. Hence we better make it optional. 
-	  *
-	  *      Also, some xlock versions also unconditionally call
-	  *      XResetScreenSaver, yielding the same kind of problems
-	  *      with DPMS that xautolock did. The latest and greatest
-	  *      xlocks also have a -resetsaver option for this very
-	  *      reason. You may want to upgrade.
-          */
-	  if (resetSaver) (void) XResetScreenSaver(d);
-  
-          setLockTrigger (lockTime);
-          (void) XSync (d,0);
+          lockerStarted (d);
       }
+#else /* VMS */
+    if (!lockerPid && !screenLocked ())
+    {
+      commandType type = lockNow ? cmd_nowLocker : cmd_locker;
+      msecs       deadline = lockNow ? now : lockDeadline ();
+
+     /*
+      *  The X connection is marked close-on-exec, so the 
+      *  locker doesn't get to see it. A locker that was started
+      *  ahead of time only needs to be told, unless we're asked
+      *  to lock right away, which is what the nowlocker is for.
+      */
+      if (builtinLocker)
+      {
+        startLockLatency (d, lk_builtin, deadline);
+
+        if (lockScreen (d))
+        {
+          lockerStarted (d);
+        }
+        else
+        {
+          abandonLockLatency ();
+        }
+      }
+      else if (   (!lockNow && (lockerPid = takePrespawned ()))
+               || (lockerPid = dpy->launchLocker (type))) /* = intended */
+      {
+        trackLocker ();
+        startLockLatency (d, lockNow ? lk_nowLocker : lk_locker, deadline);
+        lockerStarted (d);
+      }
+#endif /* VMS */
 
      /*
       *  Once the locker is running, all that needs to be done is to 
@@ -389,11 +600,13 @@ evaluateTriggers (Display* d)
       *  even if we actually failed to start the locker. Otherwise
       *  the error would "propagate" from one feature to another.
       */
-      if (killerSpecified) setKillTrigger (killTime);
+      if (killerSpecified || useFreezer) setKillTrigger (killDelay ());
 
       useRedelay = False;
     }
 
     lockNow = False;
   }
+
+  PROBE0 (evaluate__done);
 }
@@ -0,0 +1,342 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          the stuff used to run the notifier and killer hooks without
+ *          ever blocking the main loop.
+ *
+ *          Every hook that gets started becomes a job. Jobs are watched
+ *          by means of a pidfd (if available) and, optionally, a pipe
+ *          collecting their stderr. Jobs that take longer than allowed
+ *          get killed, along with anything they started themselves, and
+ *          there is a cap on the number of jobs around at any one time.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "hook.h"
+#include "options.h"
+#include "watch.h"
+#include "miscutil.h"
+
+#include <errno.h>
+
+hookStats hookStatistics[cmd_count]; /* as it says */
+
+#ifndef VMS
+typedef struct
+{
+  pid_t           pid;     /* 0 if the slot is free             */
+  commandType     type;    /* as it says                        */
+  int             pidFd;   /* pidfd of the job, or -1           */
+  int             errFd;   /* read side of its stderr, or -1    */
+  Bool            killed;  /* whether we ran out of patience    */
+  struct timespec started; /* as it says                        */
+} job;
+
+static job jobs[MAX_HOOK_JOBS];
+static int nofJobs = 0;
+
+/*
+ *  The last HOOK_CAPTURE_SIZE bytes each hook wrote to stderr.
+ */
+static struct
+{
+  char   data[HOOK_CAPTURE_SIZE];
+  size_t length;
+} captured[cmd_count];
+
+static void finishJob (job* j, int status);
+
+/*
+ *  Function for reading whatever a job has written to stderr so
+ *  far. Returns False once there's nothing left to be had.
+ */
+static Bool
+drainJob (job* j)
+{
+  char    buffer[HOOK_CAPTURE_SIZE / 2]; /* as it says */
+  ssize_t got;                           /* as it says */
+
+  while ((got = read (j->errFd, buffer, sizeof (buffer))) > 0)
+  {
+    char*  data = captured[j->type].data;
+    size_t keep = captured[j->type].length;
+
+    if (keep + got > HOOK_CAPTURE_SIZE)
+    {
+      (void) memmove (data, data + keep + got - HOOK_CAPTURE_SIZE,
+                      HOOK_CAPTURE_SIZE - got);
+      keep = HOOK_CAPTURE_SIZE - got;
+    }
+
+    (void) memcpy (data + keep, buffer, got);
+    captured[j->type].length = keep + got;
+  }
+
+  return got < 0 && errno == EAGAIN;
+}
+
+/*
+ *  Watch handlers.
+ */
+static job*
+findJob (int fd)
+{
+  int j;
+
+  for (j = -1; ++j < MAX_HOOK_JOBS; )
+  {
+    if (jobs[j].pid && (jobs[j].pidFd == fd || jobs[j].errFd == fd))
+    {
+      return &jobs[j];
+    }
+  }
+
+  return (job*) 0;
+}
+
+static Bool
+jobOutput (Display* d, int fd)
+{
+  job* j = findJob (fd);
+
+  if (j && !drainJob (j))
+  {
+    removeWatch (fd);
+    (void) close (fd);
+    j->errFd = -1;
+  }
+
+  return False;
+}
+
+static Bool
+jobExited (Display* d, int fd)
+{
+  job* j = findJob (fd);
+  int  status = 0;
+
+  if (j && waitpid (j->pid, &status, WNOHANG) > 0)
+  {
+    finishJob (j, status);
+  }
+
+  return False;
+}
+
+/*
+ *  Function for getting rid of a job that is done.
+ */
+static void
+finishJob (job* j, int status)
+{
+  hookStats*      stats = &hookStatistics[j->type];
+  struct timespec now;  /* as it says */
+  unsigned long   usec; /* as it says */
+
+  (void) clock_gettime (CLOCK_MONOTONIC, &now);
+  usec =   (now.tv_sec - j->started.tv_sec) * 1000000
+         + (now.tv_nsec - j->started.tv_nsec) / 1000;
+
+  ++stats->runs;
+  stats->totalUsec += usec;
+  if (usec > stats->maxUsec) stats->maxUsec = usec;
+
+  if (   j->killed
+      || !WIFEXITED (status)
+      || WEXITSTATUS (status) != EXIT_SUCCESS)
+  {
+    ++stats->failures;
+  }
+
+  if (j->errFd >= 0)
+  {
+    (void) drainJob (j);
+    removeWatch (j->errFd);
+    (void) close (j->errFd);
+  }
+
+  if (j->pidFd >= 0)
+  {
+    removeWatch (j->pidFd);
+    (void) close (j->pidFd);
+  }
+
+  j->pid = 0;
+  --nofJobs;
+}
+#endif /* VMS */
+
+/*
+ *  Function for starting a hook. Never waits for it to finish.
+ */
+void
+runHook (commandType type)
+{
+#ifndef VMS
+  job* j = jobs;
+  int  pipeFds[2] = { -1, -1 };
+
+  if (nofJobs >= maxHooks)
+  {
+    ++hookStatistics[type].dropped;
+    return;
+  }
+
+  while (j->pid) ++j;
+
+  if (captureHooks && pipe (pipeFds) == 0)
+  {
+    (void) fcntl (pipeFds[0], F_SETFD, FD_CLOEXEC);
+    (void) fcntl (pipeFds[1], F_SETFD, FD_CLOEXEC);
+    (void) fcntl (pipeFds[0], F_SETFL, O_NONBLOCK);
+  }
+
+  j->pid = launchCommand (type, -1, pipeFds[1]);
+  if (pipeFds[1] >= 0) (void) close (pipeFds[1]);
+
+  if (!j->pid)
+  {
+    if (pipeFds[0] >= 0) (void) close (pipeFds[0]);
+    ++hookStatistics[type].failures;
+    return;
+  }
+
+  ++nofJobs;
+  j->type = type;
+  j->killed = False;
+  j->errFd = pipeFds[0];
+  j->pidFd = -1;
+  (void) clock_gettime (CLOCK_MONOTONIC, &j->started);
+
+  if (j->errFd >= 0)
+  {
+   /*
+    *  If there's no room, checkHooks() will drain it.
+    */
+    (void) addWatch (j->errFd, jobOutput);
+  }
+
+#ifdef SYS_pidfd_open
+  if ((j->pidFd = syscall (SYS_pidfd_open, j->pid, 0)) >= 0) /* = intended */
+  {
+    (void) fcntl (j->pidFd, F_SETFD, FD_CLOEXEC);
+
+    if (!addWatch (j->pidFd, jobExited))
+    {
+      (void) close (j->pidFd);
+      j->pidFd = -1;
+    }
+  }
+#endif /* SYS_pidfd_open */
+#else /* VMS */
+  (void) launchCommand (type, -1, -1);
+#endif /* VMS */
+}
+
+/*
+ *  Function for keeping an eye on the jobs. To be called once per
+ *  main loop iteration. Collects jobs that can't be watched and kills
+ *  the ones that have run for too long.
+ */
+void
+checkHooks (void)
+{
+#ifndef VMS
+  struct timespec now;    /* as it says          */
+  int             j;      /* loop counter        */
+  int             status; /* job's exit status   */
+
+  if (!nofJobs) return;
+
+  (void) clock_gettime (CLOCK_MONOTONIC, &now);
+
+  for (j = -1; ++j < MAX_HOOK_JOBS; )
+  {
+    if (!jobs[j].pid) continue;
+
+    if (jobs[j].errFd >= 0) (void) drainJob (&jobs[j]);
+
+    if (   hookTimeout
+        && !jobs[j].killed
+        && now.tv_sec - jobs[j].started.tv_sec >= hookTimeout)
+    {
+     /*
+      *  Negative pid: the whole process group, since the hook may
+      *  well have been run through a shell.
+      */
+      (void) kill (-jobs[j].pid, SIGKILL);
+      ++hookStatistics[jobs[j].type].timeouts;
+      jobs[j].killed = True;
+    }
+
+    status = 0;
+
+    if (   (jobs[j].pidFd < 0 || jobs[j].killed)
+        && waitpid (jobs[j].pid, &status, WNOHANG) > 0)
+    {
+      finishJob (&jobs[j], status);
+    }
+  }
+#endif /* VMS */
+}
+
+/*
+ *  Function for telling whether the main loop needs to keep an eye
+ *  on any jobs.
+ */
+Bool
+hooksRunning (void)
+{
+#ifndef VMS
+  return nofJobs > 0;
+#else /* VMS */
+  return False;
+#endif /* VMS */
+}
+
+/*
+ *  Function for telling the user about the hooks.
+ */
+void
+reportHookStats (void)
+{
+  int t;
+
+  for (t = cmd_notifier - 1; ++t <= cmd_killer; )
+  {
+    hookStats* stats = &hookStatistics[t];
+
+    if (stats->runs || stats->failures || stats->dropped)
+    {
+      (void) fprintf (stderr,
+                      "%-9s : %lu runs, %lu failed, %lu timed out, "
+                      "%lu dropped, %lu us average, %lu us longest.\n",
+                      commandNames[t], stats->runs, stats->failures,
+                      stats->timeouts, stats->dropped,
+                      stats->runs ? stats->totalUsec / stats->runs : 0,
+                      stats->maxUsec);
+    }
+
+#ifndef VMS
+    if (captured[t].length)
+    {
+      (void) fprintf (stderr, "%-9s : last output:\n%.*s\n",
+                      commandNames[t], (int) captured[t].length,
+                      captured[t].data);
+    }
+#endif /* VMS */
+  }
+}
@@ -0,0 +1,279 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          the stuff used to measure how long locking takes, from the
+ *          lock deadline being reached to the locker being started,
+ *          and on to the locker actually owning the screen.
+ *
+ *          xautolock has no idea what a locker does, so the latter is
+ *          taken to be whichever comes first: an override-redirect
+ *          window covering the whole screen getting mapped, or somebody
+ *          grabbing the keyboard. Both are seen the moment they happen,
+ *          by listening on the root windows for MapNotify events and for
+ *          the focus events that a grab causes. We never grab anything
+ *          ourselves, and merely look at the events in passing. The
+ *          built-in locker simply tells us when it got its grab.
+ *
+ *          All of this only happens with -measurelocks.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "latency.h"
+#include "options.h"
+#include "display.h"
+#include "trace.h"
+#include "miscutil.h"
+
+latencyHistogram lockLatency[lk_count][ls_count];
+unsigned long    lockTimeouts[lk_count];
+const char*      lockKindNames[lk_count] = { "locker", "nowlocker", "builtin" };
+const char*      lockStageNames[ls_count] = { "spawned", "locked" };
+
+static Display* display;          /* as it says                         */
+static Bool     pending = False;  /* whether we're waiting for the lock */
+static lockKind pendingKind;      /* as it says                         */
+static msecs    pendingDeadline;  /* when the lock was due              */
+static long*    savedMasks = 0;   /* root event masks, per screen       */
+
+/*
+ *  Histogram support.
+ */
+msecs
+bucketLimit (int bucket)
+{
+  return (msecs) 1 << bucket;
+}
+
+static void
+addLatency (latencyHistogram* h, msecs latency)
+{
+  int b = 0;
+
+  if (latency < 0) latency = 0;
+  while (b < LATENCY_BUCKETS - 1 && latency > bucketLimit (b)) ++b;
+
+  ++h->buckets[b];
+  ++h->count;
+  h->sum += latency;
+  if (latency > h->max) h->max = latency;
+}
+
+/*
+ *  Function for estimating a percentile. The answer is the upper bound
+ *  of the bucket it's in, or the maximum seen if that's lower. Returns
+ *  -1 if there's nothing to go on.
+ */
+msecs
+latencyPercentile (const latencyHistogram* h, int percent)
+{
+  unsigned long seen = 0; /* as it says   */
+  int           b;        /* loop counter */
+
+  if (!h->count) return -1;
+
+  for (b = -1; ++b < LATENCY_BUCKETS; )
+  {
+    seen += h->buckets[b];
+
+    if (seen * 100 >= h->count * (unsigned long) percent)
+    {
+      return   b < LATENCY_BUCKETS - 1 && bucketLimit (b) < h->max
+             ? bucketLimit (b) : h->max;
+    }
+  }
+
+  return h->max;
+}
+
+/*
+ *  Functions for starting and stopping to listen to what happens on
+ *  the root windows. In DIY mode we may already do, and must leave the
+ *  mask alone, so a mask of -1 means it wasn't changed.
+ */
+#define ROOT_EVENTS (SubstructureNotifyMask | FocusChangeMask)
+
+static void
+watchRoots (Display* d)
+{
+  XWindowAttributes attribs; /* as it says   */
+  int               s;       /* loop counter */
+
+  savedMasks = newArray (long, ScreenCount (d));
+
+  for (s = -1; ++s < ScreenCount (d); )
+  {
+    Window root = RootWindow (d, s);
+
+    savedMasks[s] =   dpy->getAttributes (d, root, &attribs)
+                    ? attribs.your_event_mask : NoEventMask;
+
+    if ((savedMasks[s] & ROOT_EVENTS) == ROOT_EVENTS)
+    {
+      savedMasks[s] = -1;
+    }
+    else
+    {
+      dpy->selectInput (d, root, savedMasks[s] | ROOT_EVENTS);
+    }
+  }
+}
+
+static void
+unwatchRoots (void)
+{
+  int s;
+
+  if (!savedMasks) return;
+
+  for (s = -1; ++s < ScreenCount (display); )
+  {
+    if (savedMasks[s] != -1)
+    {
+      dpy->selectInput (display, RootWindow (display, s), savedMasks[s]);
+    }
+  }
+
+  free (savedMasks);
+  savedMasks = 0;
+}
+
+static void
+stopWaiting (void)
+{
+  pending = False;
+  disarmTimer (tm_latency);
+  unwatchRoots ();
+}
+
+/*
+ *  Function to be called right after the locker got started.
+ */
+void
+startLockLatency (Display* d, lockKind kind, msecs deadline)
+{
+  msecs now; /* as it says */
+
+  if (!measureLocks) return;
+  if (pending) stopWaiting ();
+
+  now = monotonicNow ();
+
+  display = d;
+  pending = True;
+  pendingKind = kind;
+  pendingDeadline = deadline;
+  addLatency (&lockLatency[kind][ls_spawned], now - deadline);
+
+  armTimer (tm_latency, deadline + LATENCY_TIMEOUT * 1000);
+  if (kind != lk_builtin) watchRoots (d);
+}
+
+/*
+ *  Function to be called once the locker has got the screen.
+ */
+void
+lockConfirmed (void)
+{
+  msecs latency;
+
+  if (!pending) return;
+
+  latency = monotonicNow () - pendingDeadline;
+  addLatency (&lockLatency[pendingKind][ls_locked], latency);
+  trace (tr_locked, pendingKind, latency);
+  stopWaiting ();
+}
+
+/*
+ *  Function to be called if the locker went away before we saw it
+ *  lock. Counts as a time-out.
+ */
+void
+abandonLockLatency (void)
+{
+  if (!pending) return;
+
+  ++lockTimeouts[pendingKind];
+  stopWaiting ();
+}
+
+Bool
+lockLatencyPending (void)
+{
+  return pending;
+}
+
+/*
+ *  Function for giving up after a while. To be called once per main
+ *  loop iteration.
+ */
+void
+checkLockLatency (Display* d)
+{
+  if (pending && timerExpired (tm_latency, monotonicNow ()))
+  {
+    abandonLockLatency ();
+  }
+}
+
+/*
+ *  Function for looking at any event we get to see while waiting. It
+ *  never claims one, as others may well want it too.
+ */
+void
+handleLatencyEvent (Display* d, XEvent* event)
+{
+  XWindowAttributes attribs; /* as it says   */
+  int               s;       /* loop counter */
+
+  if (!pending) return;
+
+  switch (event->type)
+  {
+    case MapNotify:
+      if (   event->xmap.override_redirect
+          && dpy->getAttributes (d, event->xmap.window, &attribs)
+          && attribs.x <= 0
+          && attribs.y <= 0
+          && attribs.x + attribs.width >= WidthOfScreen (attribs.screen)
+          && attribs.y + attribs.height >= HeightOfScreen (attribs.screen))
+      {
+        lockConfirmed ();
+      }
+      break;
+
+   /*
+    *  Whoever grabs the keyboard takes the focus away from wherever
+    *  it was, and the root window hears about that.
+    */
+    case FocusIn:
+    case FocusOut:
+      if (event->xfocus.mode != NotifyGrab) break;
+
+      for (s = -1; ++s < ScreenCount (d); )
+      {
+        if (event->xfocus.window == RootWindow (d, s))
+        {
+          lockConfirmed ();
+          break;
+        }
+      }
+      break;
+
+    default:
+      break;
+  }
+}
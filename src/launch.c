@@ -0,0 +1,294 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          the stuff used to start the locker, notifier and killer.
+ *
+ *          Commands are split into an argument vector once, while the
+ *          options are being processed, and are then started directly
+ *          by means of posix_spawn(). A shell only gets involved if the
+ *          command actually needs one (i.e. if it contains redirections,
+ *          pipes, variables and the like), or if the user explicitly
+ *          asked for it with -shell.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "launch.h"
+#include "options.h"
+#include "trace.h"
+#include "miscutil.h"
+
+#ifndef VMS
+#include <spawn.h>
+
+extern char** environ;
+#endif /* VMS */
+
+spawnStats  spawnStatistics[cmd_count]; /* spawn latency per command type */
+const char* commandNames[cmd_count] =   /* as used in reports             */
+  { "locker", "nowlocker", "notifier", "killer", "authhelper" };
+
+#ifndef VMS
+static char** commands[cmd_count];     /* argument vector per command    */
+
+/*
+ *  Function for splitting a command into words the way a shell
+ *  would do it. Returns 0 if the command uses anything beyond
+ *  plain words and quoting, in which case a real shell is needed.
+ */
+static char**
+tokenise (const char* text)
+{
+  char**      words;            /* resulting argument vector   */
+  char*       out;              /* where the next char goes    */
+  const char* in = text;        /* where the next char is from */
+  unsigned    nofWords = 0;     /* as it says                  */
+  char        quote;            /* current quote character     */
+
+  words = newArray (char*, strlen (text) / 2 + 2);
+  out = newArray (char, strlen (text) + 1);
+
+  for (;;)
+  {
+    while (isspace ((unsigned char) *in)) ++in;
+    if (!*in) break;
+
+    words[nofWords++] = out;
+    quote = '\0';
+
+    for (; *in && (quote || !isspace ((unsigned char) *in)); ++in)
+    {
+      if (quote == '\'')
+      {
+        if (*in == '\'') quote = '\0';
+        else             *out++ = *in;
+      }
+      else if (quote == '"')
+      {
+        if (*in == '"')
+        {
+          quote = '\0';
+        }
+        else if (*in == '$' || *in == '`')
+        {
+          goto needsShell;
+        }
+        else if (*in == '\\' && strchr ("\"\\", in[1]))
+        {
+          *out++ = *++in;
+        }
+        else
+        {
+          *out++ = *in;
+        }
+      }
+      else if (*in == '\'' || *in == '"')
+      {
+        quote = *in;
+      }
+      else if (*in == '\\' && in[1])
+      {
+        *out++ = *++in;
+      }
+      else if (   strchr ("|&;<>()$`*?[]{}~#!", *in)
+               || (*in == '=' && nofWords == 1))
+      {
+        goto needsShell;
+      }
+      else
+      {
+        *out++ = *in;
+      }
+    }
+
+    if (quote) goto needsShell;
+    *out++ = '\0';
+  }
+
+  if (nofWords)
+  {
+    words[nofWords] = 0;
+    return words;
+  }
+
+needsShell:
+  free (nofWords ? words[0] : out);
+  free (words);
+  return 0;
+}
+
+#else /* VMS */
+static const char* commands[cmd_count];
+#endif /* VMS */
+
+/*
+ *  Function for keeping track of how long it took to get a command
+ *  going, counted from the moment we decided to start it up to the
+ *  moment it got exec'ed.
+ */
+static void
+recordSpawn (commandType type, struct timespec* start)
+{
+  spawnStats*     stats = &spawnStatistics[type];
+  struct timespec stop;        /* as it says */
+  unsigned long   usec;        /* as it says */
+
+  (void) clock_gettime (CLOCK_MONOTONIC, &stop);
+
+  usec =   (stop.tv_sec - start->tv_sec) * 1000000
+         + (stop.tv_nsec - start->tv_nsec) / 1000;
+
+  ++stats->spawns;
+  stats->totalUsec += usec;
+  if (usec > stats->maxUsec) stats->maxUsec = usec;
+}
+
+/*
+ *  Function for preparing a command for later use. Only to be
+ *  called while processing the options.
+ */
+void
+prepareCommand (commandType type, const char* text)
+{
+#ifndef VMS
+  char** words; /* as it says */
+
+  if (!useShell && (words = tokenise (text))) /* = intended */
+  {
+    commands[type] = words;
+    return;
+  }
+
+ /*
+  *  On UNIX systems, we dont want to have an extra shell process
+  *  hanging about all the time while the locker is running, so we
+  *  want to insert an `exec' in front of the command. But since
+  *  this obviuosly would fail to work correctly if the command
+  *  actually consists of multiple ones, we need to look for `;'
+  *  characters first. We can only err on the safe side here...
+  */
+  if (   (type == cmd_locker || type == cmd_nowLocker)
+      && !strchr (text, ';'))
+  {
+    char* tmp;
+    (void) sprintf (tmp = newArray (char, strlen (text) + 6),
+		    "exec %s", text);
+    text = tmp;
+  }
+
+  words = newArray (char*, 4);
+  words[0] = "/bin/sh";
+  words[1] = "-c";
+  words[2] = (char*) text;
+  words[3] = 0;
+  commands[type] = words;
+#else /* VMS */
+  commands[type] = text;
+#endif /* VMS */
+}
+
+/*
+ *  Function for starting a previously prepared command. Returns
+ *  the process id of the new child, or 0 if it couldn't be started.
+ *  If inFd or errFd isn't negative, it becomes the child's stdin or
+ *  stderr respectively. Anything
+ *  but the locker gets a process group of its own, so that it can
+ *  be got rid of as a whole. The caller is responsible for collecting
+ *  the child.
+ */
+pid_t
+launchCommand (commandType type, int inFd, int errFd)
+{
+  struct timespec start;       /* as it says */
+  pid_t           pid = 0;     /* as it says */
+
+  if (!commands[type]) return 0;
+
+  (void) clock_gettime (CLOCK_MONOTONIC, &start);
+
+#ifndef VMS
+  {
+    posix_spawn_file_actions_t actions; /* as it says */
+    posix_spawnattr_t          attribs; /* as it says */
+    int                        failed;  /* as it says */
+
+    (void) posix_spawn_file_actions_init (&actions);
+    (void) posix_spawnattr_init (&attribs);
+
+    if (inFd >= 0)
+    {
+      (void) posix_spawn_file_actions_adddup2 (&actions, inFd, 0);
+    }
+
+    if (errFd >= 0)
+    {
+      (void) posix_spawn_file_actions_adddup2 (&actions, errFd, 2);
+    }
+
+    if (type != cmd_locker && type != cmd_nowLocker)
+    {
+      (void) posix_spawnattr_setflags (&attribs, POSIX_SPAWN_SETPGROUP);
+      (void) posix_spawnattr_setpgroup (&attribs, 0);
+    }
+
+    failed = posix_spawnp (&pid, commands[type][0], &actions, &attribs,
+                           commands[type], environ);
+
+    (void) posix_spawn_file_actions_destroy (&actions);
+    (void) posix_spawnattr_destroy (&attribs);
+
+    if (failed)
+    {
+      ++spawnStatistics[type].failures;
+      trace (tr_spawnFailed, type, failed);
+      return 0;
+    }
+  }
+#else /* VMS */
+ /*
+  *  For the time being, VMS users are out of luck: their xautolock
+  *  will block until the command returns.
+  */
+  { int dummy; dummy = system (commands[type]); } // Silly gcc...
+#endif /* VMS */
+
+  recordSpawn (type, &start);
+  trace (tr_spawn, type, pid);
+  return pid;
+}
+
+/*
+ *  Function for telling the user about the spawn latencies.
+ */
+void
+reportSpawnStats (void)
+{
+  int t;
+
+  for (t = -1; ++t < cmd_count; )
+  {
+    spawnStats* stats = &spawnStatistics[t];
+
+    if (stats->spawns || stats->failures)
+    {
+      (void) fprintf (stderr,
+                      "%-9s : %lu spawned, %lu failed, "
+                      "%lu us average, %lu us worst.\n",
+                      commandNames[t], stats->spawns, stats->failures,
+                      stats->spawns ? stats->totalUsec / stats->spawns : 0,
+                      stats->maxUsec);
+    }
+  }
+}
@@ -0,0 +1,458 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          the built-in locker.
+ *
+ *          The built-in locker is as simple as they come: a black
+ *          override-redirect window on every screen, plus a keyboard
+ *          and pointer grab. Whatever gets typed is collected, and
+ *          checked when Return is hit, either through PAM or by feeding
+ *          it to the -authhelper command. Either way, that happens in
+ *          a child, so that the main loop never waits for the verdict.
+ *          It uses our own X connection, so locking takes neither a
+ *          fork() nor a new connection. The flip side is that the lock
+ *          goes away with us, which is why we refuse to be told to exit
+ *          while it's there.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "lock.h"
+#include "options.h"
+#include "state.h"
+#include "launch.h"
+#include "watch.h"
+#include "latency.h"
+#include "session.h"
+#include "trace.h"
+#include "miscutil.h"
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <X11/keysym.h>
+
+#ifdef HasPam
+#include <security/pam_appl.h>
+#endif /* HasPam */
+
+static Display* display = 0;      /* as it says                      */
+static Bool     locked = False;   /* as it says                      */
+static Window*  windows = 0;      /* one per screen                  */
+static int      nofWindows = 0;   /* as it says                      */
+static Cursor   blankCursor;      /* as it says                      */
+static Bool     keyboardGrabbed;  /* as it says                      */
+static Bool     pointerGrabbed;   /* as it says                      */
+static char     typed[MAX_PASSWORD_LEN + 1];
+                                  /* what has been typed so far      */
+static size_t   nofTyped = 0;     /* as it says                      */
+static pid_t    helperPid = 0;    /* password check now running      */
+static int      helperFd = -1;    /* pidfd of the latter, or -1      */
+
+/*
+ *  Function for forgetting whatever has been typed.
+ */
+static void
+clearTyped (void)
+{
+  volatile char* ptr = typed;
+
+  while (nofTyped) ptr[--nofTyped] = '\0';
+}
+
+/*
+ *  Function for (re)trying to get hold of the keyboard and pointer.
+ *  Some other client may have them grabbed for the moment, in which
+ *  case we simply try again later on. The windows are on top anyway.
+ */
+static void
+grabInput (void)
+{
+  if (!keyboardGrabbed)
+  {
+    keyboardGrabbed =
+         XGrabKeyboard (display, windows[0], False, GrabModeAsync,
+                        GrabModeAsync, CurrentTime)
+      == GrabSuccess;
+
+    if (keyboardGrabbed) lockConfirmed ();
+  }
+
+  if (!pointerGrabbed)
+  {
+    pointerGrabbed =
+         XGrabPointer (display, windows[0], False,
+                       ButtonPressMask | ButtonReleaseMask | PointerMotionMask,
+                       GrabModeAsync, GrabModeAsync, None, blankCursor,
+                       CurrentTime)
+      == GrabSuccess;
+  }
+}
+
+/*
+ *  Function for checking a password through PAM. Note that PAM may
+ *  well take its time to tell us no. That's why it gets called in a
+ *  child of ours, which is then treated like an -authhelper.
+ */
+#ifdef HasPam
+static int
+pamConversation (int nofMessages, const struct pam_message** messages,
+                 struct pam_response** responses, void* password)
+{
+  struct pam_response* reply; /* as it says   */
+  int                  m;     /* loop counter */
+
+  if (!(reply = calloc (nofMessages, sizeof (*reply)))) return PAM_BUF_ERR;
+
+  for (m = -1; ++m < nofMessages; )
+  {
+    if (   messages[m]->msg_style == PAM_PROMPT_ECHO_OFF
+        || messages[m]->msg_style == PAM_PROMPT_ECHO_ON)
+    {
+      reply[m].resp = strdup ((const char*) password);
+    }
+  }
+
+  *responses = reply;
+  return PAM_SUCCESS;
+}
+
+static Bool
+pamAuthenticate (const char* password)
+{
+  struct pam_conv conversation;  /* as it says */
+  pam_handle_t*   handle;        /* as it says */
+  struct passwd*  user;          /* as it says */
+  int             result;        /* as it says */
+
+  if (!(user = getpwuid (getuid ()))) return False; /* = intended */
+
+  conversation.conv = pamConversation;
+  conversation.appdata_ptr = (void*) password;
+
+  result = pam_start (PAM_SERVICE, user->pw_name, &conversation, &handle);
+  if (result == PAM_SUCCESS) result = pam_authenticate (handle, 0);
+  (void) pam_end (handle, result);
+
+  return result == PAM_SUCCESS;
+}
+#endif /* HasPam */
+
+/*
+ *  -authhelper support. The helper gets the password on its stdin
+ *  and is expected to exit successfully if, and only if, it's the
+ *  right one. We never wait for it.
+ */
+static void
+helperDone (int status)
+{
+  if (helperFd >= 0)
+  {
+    removeWatch (helperFd);
+    (void) close (helperFd);
+    helperFd = -1;
+  }
+
+  helperPid = 0;
+
+  if (WIFEXITED (status) && WEXITSTATUS (status) == EXIT_SUCCESS)
+  {
+    unlockScreen ();
+  }
+  else
+  {
+    (void) XBell (display, bellPercent);
+  }
+}
+
+static Bool
+helperExited (Display* d, int fd)
+{
+  int status = 0;
+
+  if (helperPid && waitpid (helperPid, &status, WNOHANG) > 0)
+  {
+    helperDone (status);
+  }
+
+  return True;
+}
+
+static void
+watchHelper (void)
+{
+#ifdef SYS_pidfd_open
+  if ((helperFd = syscall (SYS_pidfd_open, helperPid, 0)) >= 0) /* = intended */
+  {
+    (void) fcntl (helperFd, F_SETFD, FD_CLOEXEC);
+
+    if (!addWatch (helperFd, helperExited))
+    {
+      (void) close (helperFd);
+      helperFd = -1;
+    }
+  }
+#endif /* SYS_pidfd_open */
+}
+
+static void
+startHelper (void)
+{
+  int fds[2]; /* socket, so that we don't get SIGPIPE-d */
+
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, fds))
+  {
+    (void) XBell (display, bellPercent);
+    return;
+  }
+
+  (void) fcntl (fds[0], F_SETFD, FD_CLOEXEC);
+  (void) fcntl (fds[1], F_SETFD, FD_CLOEXEC);
+
+  if ((helperPid = launchCommand (cmd_authHelper, fds[0], -1))) /* = intended */
+  {
+    typed[nofTyped] = '\n';
+    (void) send (fds[1], typed, nofTyped + 1, MSG_NOSIGNAL);
+    typed[nofTyped] = '\0';
+    watchHelper ();
+  }
+  else
+  {
+    (void) XBell (display, bellPercent);
+  }
+
+  (void) close (fds[0]);
+  (void) close (fds[1]);
+}
+
+#ifdef HasPam
+/*
+ *  Same thing, but with a child of ours asking PAM. It must not
+ *  touch the X connection, hence the _exit ().
+ */
+static void
+startPam (void)
+{
+  if (!(helperPid = fork ())) /* = intended */
+  {
+    _exit (pamAuthenticate (typed) ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+
+  if (helperPid < 0)
+  {
+    helperPid = 0;
+    (void) XBell (display, bellPercent);
+    return;
+  }
+
+  watchHelper ();
+}
+#endif /* HasPam */
+
+/*
+ *  Function for checking what has been typed.
+ */
+static void
+verifyTyped (void)
+{
+  if (authHelperSpecified)
+  {
+    startHelper ();
+  }
+#ifdef HasPam
+  else
+  {
+    startPam ();
+  }
+#endif /* HasPam */
+
+  clearTyped ();
+}
+
+/*
+ *  Function for locking the screen. Returns False if that can't
+ *  be done at all, True otherwise (even if we didn't manage to grab
+ *  the keyboard and the pointer yet).
+ */
+Bool
+lockScreen (Display* d)
+{
+  XSetWindowAttributes attribs;  /* as it says   */
+  XColor               black;    /* as it says   */
+  Pixmap               empty;    /* as it says   */
+  static char          bits[] = { 0 };
+  int                  s;        /* loop counter */
+
+  if (locked) return True;
+
+  display = d;
+  nofWindows = ScreenCount (d);
+  windows = newArray (Window, nofWindows);
+
+  empty = XCreateBitmapFromData (d, DefaultRootWindow (d), bits, 1, 1);
+  black.pixel = BlackPixel (d, DefaultScreen (d));
+  black.red = black.green = black.blue = 0;
+  blankCursor = XCreatePixmapCursor (d, empty, empty, &black, &black, 0, 0);
+  (void) XFreePixmap (d, empty);
+
+  for (s = -1; ++s < nofWindows; )
+  {
+    Screen* screen = ScreenOfDisplay (d, s);
+
+    attribs.override_redirect = True;
+    attribs.background_pixel = BlackPixelOfScreen (screen);
+    attribs.event_mask = KeyPressMask | VisibilityChangeMask;
+    attribs.cursor = blankCursor;
+
+    windows[s] = XCreateWindow (d, RootWindowOfScreen (screen), 0, 0,
+                                WidthOfScreen (screen),
+                                HeightOfScreen (screen), 0,
+                                CopyFromParent, InputOutput, CopyFromParent,
+                                  CWOverrideRedirect | CWBackPixel
+                                | CWEventMask | CWCursor,
+                                &attribs);
+    (void) XMapRaised (d, windows[s]);
+  }
+
+  keyboardGrabbed = pointerGrabbed = False;
+  grabInput ();
+  clearTyped ();
+  locked = True;
+
+  return True;
+}
+
+/*
+ *  Function for unlocking the screen. Behaves as if an external
+ *  locker had exited successfully.
+ */
+void
+unlockScreen (void)
+{
+  int s;
+
+  if (!locked) return;
+
+  if (keyboardGrabbed) (void) XUngrabKeyboard (display, CurrentTime);
+  if (pointerGrabbed)  (void) XUngrabPointer (display, CurrentTime);
+
+  for (s = -1; ++s < nofWindows; ) (void) XDestroyWindow (display, windows[s]);
+  (void) XFreeCursor (display, blankCursor);
+  (void) XSync (display, 0);
+
+  free (windows);
+  windows = 0;
+  nofWindows = 0;
+  clearTyped ();
+  locked = False;
+  trace (tr_lockerExit, 0, 0);
+  abandonLockLatency ();
+  sessionUnlocked ();
+
+  disableKillTrigger ();
+  useRedelay = True;
+  setLockTrigger (lockTime);
+}
+
+Bool
+screenLocked (void)
+{
+  return locked;
+}
+
+/*
+ *  Function for keeping things going while locked. To be called once
+ *  per main loop iteration.
+ */
+void
+checkLock (void)
+{
+  int status = 0;
+
+  if (!locked) return;
+
+  if (!keyboardGrabbed || !pointerGrabbed) grabInput ();
+
+  if (   helperPid
+      && helperFd < 0
+      && waitpid (helperPid, &status, WNOHANG) > 0)
+  {
+    helperDone (status);
+  }
+}
+
+/*
+ *  Function for handling any event aimed at the locker. Returns True
+ *  if the event was one of ours.
+ */
+Bool
+handleLockEvent (Display* d, XEvent* event)
+{
+  KeySym keysym;     /* as it says */
+  char   buffer[32]; /* as it says */
+  int    length;     /* as it says */
+  int    c;          /* as it says */
+
+  if (!locked) return False;
+
+  switch (event->type)
+  {
+    case VisibilityNotify:
+      if (event->xvisibility.state != VisibilityUnobscured)
+      {
+        (void) XRaiseWindow (d, event->xvisibility.window);
+      }
+      return True;
+
+    case KeyPress:
+      break;
+
+    default:
+      return False;
+  }
+
+ /*
+  *  Ignore anything typed while the helper is still making up
+  *  its mind.
+  */
+  if (helperPid) return True;
+
+  length = XLookupString (&event->xkey, buffer, sizeof (buffer), &keysym, 0);
+
+  switch (keysym)
+  {
+    case XK_Return:
+    case XK_KP_Enter:
+      verifyTyped ();
+      break;
+
+    case XK_Escape:
+      clearTyped ();
+      break;
+
+    case XK_BackSpace:
+    case XK_Delete:
+      if (nofTyped) typed[--nofTyped] = '\0';
+      break;
+
+    default:
+      for (c = -1; ++c < length && nofTyped < MAX_PASSWORD_LEN; )
+      {
+        typed[nofTyped++] = buffer[c];
+      }
+  }
+
+  (void) memset (buffer, 0, sizeof (buffer));
+  return True;
+}
@@ -20,7 +20,15 @@
 
 #include "message.h"
 #include "state.h"
+#include "watch.h"
+#include "engine.h"
+#include "lock.h"
 #include "options.h"
+#include "metrics.h"
+#include "latency.h"
+#include "display.h"
+#include "probes.h"
+#include "trace.h"
 #include "miscutil.h"
 
 static Atom semaphore;       /* semaphore property for locating 
@@ -34,10 +42,95 @@ static Atom messageResponse; /* indicates a response from the
 #define MESSAGE_REQUEST "_MESSAGE_REQUEST"
 #define MESSAGE_RESPONSE "_MESSAGE_RESPONSE"
 
+/*
+ *  Flood control. Every sender gets a token bucket of IPC_BURST
+ *  messages that fills up at IPC_RATE per second. Whatever comes in
+ *  while its bucket is empty gets denied. Senders are told apart by
+ *  the X client the window they want their response on belongs to,
+ *  not by the window itself: each invocation of xautolock creates a
+ *  new one, but a script running it in a loop tends to get the same
+ *  client slot over and over again. The last IPC_SENDERS of them are
+ *  kept track of, so one that floods us can't starve the others. The
+ *  window is whatever the sender says it is, so this is about broken
+ *  scripts, not about clients out to get us. Those could simply fake
+ *  the user's input anyway.
+ */
+typedef struct
+{
+  XID   client; /* resource id base of the sender */
+  msecs last;   /* when it last sent anything     */
+  msecs tokens; /* in thousandths of a message    */
+} sender;
+
+static sender       senders[IPC_SENDERS]; /* as it says                  */
+static int          handled;              /* messages handled during
+                                             this main loop iteration    */
+static message      lastRequest;          /* last one acted upon during
+                                             this main loop iteration    */
+static fullResponse lastResponse;         /* and what came of it         */
+
+static Bool
+withinRate (Display* d, Window w, msecs now)
+{
+  XID     client;       /* as it says   */
+  sender* s = senders;  /* as it says   */
+  int     i;            /* loop counter */
+
+ /*
+  *  The server hands out the same resource id mask to every client.
+  *  Xlib keeps ours in what it only lets us see as private5.
+  */
+  client = w & ~((_XPrivDisplay) d)->private5;
+
+  for (i = -1; ++i < IPC_SENDERS; )
+  {
+    if (senders[i].last && senders[i].client == client)
+    {
+      s = &senders[i];
+      break;
+    }
+
+    if (senders[i].last < s->last) s = &senders[i];
+  }
+
+  if (!s->last || s->client != client)
+  {
+    s->client = client;
+    s->tokens = IPC_BURST * 1000;
+  }
+  else if ((s->tokens += (now - s->last) * IPC_RATE) > IPC_BURST * 1000)
+  {
+    s->tokens = IPC_BURST * 1000;
+  }
+
+  s->last = now;
+
+  if (s->tokens < 1000) return False;
+
+  s->tokens -= 1000;
+  return True;
+}
+
+/*
+ *  Messages that leave things as they are when acted upon twice in a
+ *  row. If the same one comes in again during the same iteration of
+ *  the main loop, without anything else having been acted upon in
+ *  between, it simply gets the same response again.
+ */
+static Bool
+idempotent (message request)
+{
+  return    request == msg_disable || request == msg_enable
+         || request == msg_isDisabled || request == msg_dumpTrace;
+}
+
 /*
 *  Message handlers. The response paramater is used to modify the response that
 *  is sent back. If the return value is True then control returns to the main
 *  loop immediately instead of waiting for more messages.
+*
+*  The built-in locker lives and dies with us, and disabling would leave
+*  it up for good. So none of that while it holds the screen.
 */
 static Bool
 disableByMessage (Display* d, Window root, fullResponse* response)
@@ -45,7 +138,7 @@ disableByMessage (Display* d, Window root, fullResponse* response)
   /*
   *  The order in which things are done is rather important here.
   */
-  if (!secure)
+  if (!secure && !screenLocked ())
   {
     setLockTrigger (lockTime);
     disableKillTrigger ();
@@ -64,6 +157,7 @@ enableByMessage (Display* d, Window root, fullResponse* response)
 {
   if (!secure) 
   {
+    PROBE2 (reset_triggers, rs_message, msg_enable);
     resetTriggers ();
     disabled = False;
     response->type = response_success;
@@ -78,7 +172,7 @@ enableByMessage (Display* d, Window root, fullResponse* response)
 static Bool
 toggleByMessage (Display* d, Window root, fullResponse* response)
 {
-  if (!secure)
+  if (!secure && (disabled || !screenLocked ()))
   {
     if ((disabled = !disabled)) /* = intended */
     {
@@ -87,6 +181,7 @@ toggleByMessage (Display* d, Window root, fullResponse* response)
     }
     else
     {
+      PROBE2 (reset_triggers, rs_message, msg_toggle);
       resetTriggers ();
     }
     response->type = response_success;
@@ -101,7 +196,7 @@ toggleByMessage (Display* d, Window root, fullResponse* response)
 static Bool
 exitByMessage (Display* d, Window root, fullResponse* response)
 {
-  if (!secure)
+  if (!secure && !screenLocked ())
   {
     error0 ("Exiting. Bye bye...\n");
     exitNow = True;
@@ -136,7 +231,12 @@ unlockNowByMessage (Display* d, Window root, fullResponse* response)
 {
   if (!secure && !disabled)
   {
+   /*
+    *  Don't wait for the next round of the main loop to get rid
+    *  of the locker. If it exits, we'll hear about it right away.
+    */
     unlockNow = True;
+    checkLocker ();
     response->type = response_success;
     return True;
   }
@@ -150,7 +250,7 @@ unlockNowByMessage (Display* d, Window root, fullResponse* response)
 static Bool
 restartByMessage (Display* d, Window root, fullResponse* response)
 {
-  if (!secure)
+  if (!secure && !screenLocked ())
   {
     exitNow = True;
     restart = True;
@@ -172,6 +272,51 @@ isDisabledMessage (Display* d, Window root, fullResponse* response)
   return False;
 }
 
+static Bool
+dumpTraceByMessage (Display* d, Window root, fullResponse* response)
+{
+  response->type = dumpTrace () ? response_success : response_failure;
+  return False;
+}
+
+/*
+*  The lock latency statistics don't fit in a single response, so the
+*  client asks for them one locker kind and stage at a time. Stage
+*  ls_count gets the number of time-outs.
+*/
+static Bool
+lockLatencyByMessage (Display* d, XClientMessageEvent* request,
+                      fullResponse* response)
+{
+  long                    kind = request->data.l[1];
+  long                    stage = request->data.l[2];
+  const latencyHistogram* h;
+
+  if (kind < 0 || kind >= lk_count || stage < 0 || stage > ls_count)
+  {
+    response->type = response_failure;
+    return False;
+  }
+
+  response->type = response_latency;
+
+  if (stage == ls_count)
+  {
+    response->data[0] = lockTimeouts[kind];
+    response->data[1] = response->data[2] = response->data[3] = -1;
+  }
+  else
+  {
+    h = &lockLatency[kind][stage];
+    response->data[0] = h->count;
+    response->data[1] = latencyPercentile (h, 50);
+    response->data[2] = latencyPercentile (h, 90);
+    response->data[3] = latencyPercentile (h, 99);
+  }
+
+  return False;
+}
+
 /*
 *  Event handler function passed to eventListen. Receives the display and
 *  a pointer to the event being handles and return a Bool specifying whether
@@ -183,64 +328,80 @@ void
 eventListen(Display* d, double timeout, eventHandler callback)
 {
   int fd;                  /* file descriptor to wait on         */
+  int maxFd;               /* highest file descriptor to wait on */
+  fd_set fds;              /* file descriptors to wait on        */
   struct timeval timeLeft; /* amount of time until timeout       */
-  struct timeval now;      /* current time on each loop          */
-  struct timeval until;    /* time to return at if still waiting */
+  msecs left;              /* same, in milliseconds              */
+  msecs until;             /* time to return at if still waiting */
   XEvent event;            /* event received from server         */
 
 /*
   *  Continually receive events from the X server and pass them to the callback
-  *  until either the timeout is reached or the callback returns False.
+  *  until either the timeout is reached or the callback returns False. Any
+  *  other file descriptors being watched are handled in passing. A negative
+  *  timeout means to wait until something interesting happens. The timeout
+  *  is also checked between queued events, so that a flood of them can't
+  *  keep us away from the main loop.
   */
   
-  if (timeout <= 0)
+  if (timeout == 0)
   {
     return;
   }
   fd = ConnectionNumber(d);
-  fd_set fds;
-  FD_ZERO(&fds);
-  FD_SET(fd, &fds);
   
   timeLeft.tv_sec = (int) timeout;
   timeLeft.tv_usec = (int) ((timeout - timeLeft.tv_sec) * 1000000);
-  
-  gettimeofday(&now, NULL);
-  until.tv_sec = now.tv_sec + timeLeft.tv_sec;
-  until.tv_usec = now.tv_usec + timeLeft.tv_usec;
-  if (until.tv_usec >= 1000000)
-  {
-    until.tv_usec -= 1000000;
-    until.tv_sec += 1;
-  }
+  until = monotonicNow () + (msecs) (timeout * 1000);
   
   while (!exitNow) {
-    if (XPending(d) || (select(fd+1, &fds, NULL, NULL, &timeLeft) > 0)) {
-      XNextEvent(d, &event);
+    if (dpy->pending (d)) {
+      dpy->nextEvent (d, &event);
       if(!callback(d, &event))
       {
         break;
       }
-    } else {
+      if (timeout > 0 && until <= monotonicNow ())
+      {
+        break;
+      }
+      continue;
     }
-    gettimeofday(&now, NULL);
-    timeLeft.tv_sec = until.tv_sec - now.tv_sec;
-    timeLeft.tv_usec = until.tv_usec - now.tv_usec;
-    if (timeLeft.tv_usec < 0)
+
+    FD_ZERO(&fds);
+    FD_SET(fd, &fds);
+    maxFd = setWatches(&fds, fd);
+
+    if (dpy->wait (maxFd+1, &fds, timeout < 0 ? NULL : &timeLeft) > 0)
     {
-      if (timeLeft.tv_sec <= 0)
+      FD_CLR(fd, &fds);
+      if (handleWatches(d, &fds))
       {
         break;
       }
-      timeLeft.tv_usec += 1000000;
-      timeLeft.tv_sec -= 1;
+    }
+    else if (timeout < 0)
+    {
+      continue;
+    }
+
+    if (timeout > 0)
+    {
+      if ((left = until - monotonicNow ()) <= 0) /* = intended */
+      {
+        break;
+      }
+      timeLeft.tv_sec = left / 1000;
+      timeLeft.tv_usec = (left % 1000) * 1000;
     }
   }
 }
 
 /*
 *  Event handler used to receive messages while running. Invokes actions based
-*  on request type and sends a response for each indicating success or failure
+*  on request type and sends a response for each indicating success or failure.
+*  After IPC_BATCH of them, control goes back to the main loop, so that looking
+*  at the user and evaluating the triggers don't get starved.
 */
 Bool
 handleRequest(Display* d, XEvent* event)
@@ -250,15 +411,40 @@ handleRequest(Display* d, XEvent* event)
   XEvent responseEvent; /* event sent to requester */
   Bool stopWaiting;     /* whether to stop waiting
                            for events after this   */
+  Bool limited;         /* whether it was one too
+                           many from its sender    */
 
   stopWaiting = False;
 
+  handleLatencyEvent (d, event);
+
+  if (handleLockEvent (d, event))
+  {
+    return True;
+  }
+
   if (event->type == ClientMessage
     && event->xclient.message_type == messageRequest) {
     message request = event->xclient.data.l[0];
     root = RootWindowOfScreen (ScreenOfDisplay (d, 0));
     fullResponse* responseBody = (fullResponse*) &responseEvent.xclient.data;
-    switch (request)
+    ++metrics.ipcRequests[request > msg_none && request < msg_count
+                          ? request : msg_none];
+
+    limited = !withinRate (d, event->xclient.window, monotonicNow ());
+
+    PROBE1 (request__start, request);
+    if (limited)
+    {
+      responseBody->type = response_failure;
+      ++metrics.ipcDropped;
+    }
+    else if (idempotent (request) && request == lastRequest)
+    {
+      *responseBody = lastResponse;
+      ++metrics.ipcCoalesced;
+    }
+    else switch (request)
     {
       case msg_disable:
         stopWaiting = disableByMessage (d, root, responseBody);
@@ -292,18 +478,36 @@ handleRequest(Display* d, XEvent* event)
         stopWaiting = isDisabledMessage (d, root, responseBody);
       break;
 
+      case msg_dumpTrace:
+        stopWaiting = dumpTraceByMessage (d, root, responseBody);
+      break;
+
+      case msg_lockLatency:
+        stopWaiting = lockLatencyByMessage (d, &event->xclient, responseBody);
+      break;
+
       default:
       /* unknown message, ignore silently */
        responseBody->type = response_none;
       break;
     }
+    if (!limited)
+    {
+      lastRequest = request;
+      lastResponse = *responseBody;
+    }
+    if (++handled >= IPC_BATCH) stopWaiting = True;
+
+    trace (tr_message, request, responseBody->type);
+    PROBE2 (request__done, request, responseBody->type);
+
     if (responseBody->type != response_none)
     {
       responseEvent.type = ClientMessage;
       responseEvent.xclient.display = d;
       responseEvent.xclient.message_type = messageResponse;
       responseEvent.xclient.format = 32;
-      XSendEvent(d, event->xclient.window, False, 0, &responseEvent);
+      dpy->sendEvent (d, event->xclient.window, &responseEvent);
     }
   }
   return !stopWaiting;
@@ -328,7 +532,7 @@ handleResponse(Display* d, XEvent* event)
       
       case response_failure:
         error0("The operation was denied by the target instance. "
-          "It may be in secure mode.\n");
+          "It may be in secure mode, or getting too many messages.\n");
         exit(EXIT_FAILURE);
       break;
       
@@ -354,12 +558,93 @@ handleResponse(Display* d, XEvent* event)
   }
 }
 
+/*
+*  Client side of msg_lockLatency. Prints a table instead of exiting on
+*  the first response.
+*/
+static fullResponse latencyResponse; /* last response received */
+static Bool         gotResponse;     /* as it says             */
+
+static Bool
+handleLatencyResponse (Display* d, XEvent* event)
+{
+  if (   event->type == ClientMessage
+      && event->xclient.message_type == messageResponse)
+  {
+    latencyResponse = *(fullResponse*) &event->xclient.data;
+    gotResponse = True;
+    return False;
+  }
+
+  return True;
+}
+
+static Bool
+askLockLatency (Display* d, Window target, Window w, int kind, int stage)
+{
+  XEvent request; /* event containing message */
+
+  request.type = ClientMessage;
+  request.xclient.display = d;
+  request.xclient.window = w;
+  request.xclient.message_type = messageRequest;
+  request.xclient.format = 32;
+  request.xclient.data.l[0] = msg_lockLatency;
+  request.xclient.data.l[1] = kind;
+  request.xclient.data.l[2] = stage;
+  XSendEvent (d, target, False, 0, &request);
+
+  gotResponse = False;
+  eventListen (d, 1, handleLatencyResponse);
+
+  return gotResponse && latencyResponse.type == response_latency;
+}
+
+static void
+printLatency (long value)
+{
+  if (value < 0) (void) printf (" %8s", "-");
+  else           (void) printf (" %8ld", value);
+}
+
+static void
+queryLockLatency (Display* d, Window target, Window w)
+{
+  int kind;  /* loop counter */
+  int stage; /* loop counter */
+  int p;     /* loop counter */
+
+  (void) printf ("%-10s %-8s %8s %8s %8s %8s\n",
+                 "locker", "stage", "count", "p50 ms", "p90 ms", "p99 ms");
+
+  for (kind = -1; ++kind < lk_count; )
+  {
+    for (stage = -1; ++stage <= ls_count; )
+    {
+      if (!askLockLatency (d, target, w, kind, stage))
+      {
+        error1 ("No lock latency statistics from the running %s.\n",
+                progName);
+        exit (EXIT_FAILURE);
+      }
+
+      (void) printf ("%-10s %-8s %8ld", lockKindNames[kind],
+                     stage < ls_count ? lockStageNames[stage] : "timeouts",
+                     latencyResponse.data[0]);
+      for (p = 0; ++p < 4; ) printLatency (latencyResponse.data[p]);
+      (void) printf ("\n");
+    }
+  }
+}
+
 /*
 *  Waits for and handles messages from other xautolock instances until the
-*  timeout elapses (in seconds)
+*  timeout elapses (in seconds, negative meaning forever)
 */
 void
 lookForMessages(Display* d, double timeout){
+    handled = 0;
+    lastRequest = msg_none;
     eventListen(d, timeout, handleRequest);
 }
     
@@ -433,6 +718,11 @@ checkConnectionAndSendMessage (Display* d, Window w)
         exit (EXIT_FAILURE);
       }
     }
+    else if (messageToSend == msg_lockLatency)
+    {
+      queryLockLatency (d, (Window) *contents, w);
+      exit (EXIT_SUCCESS);
+    }
     else if (messageToSend)
     {
      /*
@@ -446,7 +736,8 @@ checkConnectionAndSendMessage (Display* d, Window w)
       request.xclient.data.l[0] = messageToSend;
       XSendEvent (d, (Window) *contents, False, 0, &request);
       eventListen (d, 1, handleResponse);
-      exit (EXIT_SUCCESS);
+      error1 ("No response from the running %s.\n", progName);
+      exit (EXIT_FAILURE);
     }
     else
     {
@@ -0,0 +1,404 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          the stuff used to keep and serve run time metrics.
+ *
+ *          The metrics are plain counters, bumped wherever something
+ *          happens. If -metrics is given, we listen on a UNIX domain
+ *          socket, and anyone connecting to it gets the lot in the
+ *          Prometheus text exposition format, after which we hang up.
+ *          Nothing is done until somebody asks.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "metrics.h"
+#include "launch.h"
+#include "hook.h"
+#include "latency.h"
+#include "session.h"
+#include "pressure.h"
+#include "stagger.h"
+#include "watch.h"
+#include "miscutil.h"
+
+#include <stdarg.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+metricsData metrics; /* as it says */
+
+#ifndef VMS
+static const char* sourceNames[xs_count] = { "pointer", "idle", "diy" };
+
+static const char* messageNames[msg_count] =
+  { "unknown", "disable", "enable", "toggle", "exit", "locknow",
+    "unlocknow", "restart", "isdisabled", "dumptrace", "locklatency" };
+
+static int    listenFd = -1;         /* as it says                  */
+static char   page[METRICS_SIZE];    /* what gets sent              */
+static size_t pageLength;            /* as it says                  */
+
+/*
+ *  Function for adding a line to the page. Anything that doesn't
+ *  fit gets lost.
+ */
+static void
+put (const char* format, ...)
+{
+  va_list args; /* as it says */
+  int     len;  /* as it says */
+
+  va_start (args, format);
+  len = vsnprintf (page + pageLength, sizeof (page) - pageLength,
+                   format, args);
+  va_end (args);
+
+  if (len > 0 && pageLength + len < sizeof (page)) pageLength += len;
+}
+
+static void
+putHeader (const char* name, const char* type, const char* help)
+{
+  put ("# HELP xautolock_%s %s\n# TYPE xautolock_%s %s\n",
+       name, help, name, type);
+}
+
+/*
+ *  Function for putting the page together.
+ */
+static void
+buildPage (void)
+{
+  int i; /* loop counter */
+  int s; /* loop counter */
+  int b; /* loop counter */
+
+  pageLength = 0;
+
+  putHeader ("wakeups_total", "counter", "Main loop iterations.");
+  put ("xautolock_wakeups_total %lu\n", metrics.wakeups);
+
+  putHeader ("x_requests_total", "counter", "X requests issued.");
+  for (i = -1; ++i < xs_count; )
+  {
+    put ("xautolock_x_requests_total{source=\"%s\"} %lu\n",
+         sourceNames[i], metrics.xRequests[i]);
+  }
+
+  putHeader ("x_round_trips_total", "counter",
+             "X requests that waited for a reply.");
+  for (i = -1; ++i < xs_count; )
+  {
+    put ("xautolock_x_round_trips_total{source=\"%s\"} %lu\n",
+         sourceNames[i], metrics.xRoundTrips[i]);
+  }
+
+  putHeader ("ipc_requests_total", "counter", "Messages received.");
+  for (i = -1; ++i < msg_count; )
+  {
+    put ("xautolock_ipc_requests_total{message=\"%s\"} %lu\n",
+         messageNames[i], metrics.ipcRequests[i]);
+  }
+
+  putHeader ("ipc_dropped_total", "counter",
+             "Messages dropped because their sender sent too many.");
+  put ("xautolock_ipc_dropped_total %lu\n", metrics.ipcDropped);
+
+  putHeader ("ipc_coalesced_total", "counter",
+             "Messages answered without acting on them again.");
+  put ("xautolock_ipc_coalesced_total %lu\n", metrics.ipcCoalesced);
+
+  putHeader ("spawns_total", "counter", "Commands started.");
+  for (i = -1; ++i < cmd_count; )
+  {
+    put ("xautolock_spawns_total{command=\"%s\"} %lu\n",
+         commandNames[i], spawnStatistics[i].spawns);
+  }
+
+  putHeader ("spawn_failures_total", "counter", "Commands not started.");
+  for (i = -1; ++i < cmd_count; )
+  {
+    put ("xautolock_spawn_failures_total{command=\"%s\"} %lu\n",
+         commandNames[i], spawnStatistics[i].failures);
+  }
+
+  putHeader ("hook_failures_total", "counter",
+             "Hooks that failed, crashed or timed out.");
+  for (i = cmd_notifier - 1; ++i <= cmd_killer; )
+  {
+    put ("xautolock_hook_failures_total{command=\"%s\"} %lu\n",
+         commandNames[i], hookStatistics[i].failures);
+  }
+
+  putHeader ("hooks_dropped_total", "counter",
+             "Hooks not started because too many were running.");
+  for (i = cmd_notifier - 1; ++i <= cmd_killer; )
+  {
+    put ("xautolock_hooks_dropped_total{command=\"%s\"} %lu\n",
+         commandNames[i], hookStatistics[i].dropped);
+  }
+
+  putHeader ("lock_latency_seconds", "histogram",
+             "Time from the lock deadline to each locking stage.");
+  for (i = -1; ++i < lk_count; )
+  {
+    for (s = -1; ++s < ls_count; )
+    {
+      const latencyHistogram* h = &lockLatency[i][s];
+      unsigned long           total = 0;
+
+      for (b = -1; ++b < LATENCY_BUCKETS - 1; )
+      {
+        total += h->buckets[b];
+        put ("xautolock_lock_latency_seconds_bucket"
+             "{command=\"%s\",stage=\"%s\",le=\"%g\"} %lu\n",
+             lockKindNames[i], lockStageNames[s],
+             bucketLimit (b) / 1000.0, total);
+      }
+
+      put ("xautolock_lock_latency_seconds_bucket"
+           "{command=\"%s\",stage=\"%s\",le=\"+Inf\"} %lu\n",
+           lockKindNames[i], lockStageNames[s], h->count);
+      put ("xautolock_lock_latency_seconds_sum"
+           "{command=\"%s\",stage=\"%s\"} %.3f\n",
+           lockKindNames[i], lockStageNames[s], h->sum / 1000.0);
+      put ("xautolock_lock_latency_seconds_count"
+           "{command=\"%s\",stage=\"%s\"} %lu\n",
+           lockKindNames[i], lockStageNames[s], h->count);
+    }
+  }
+
+  putHeader ("lock_timeouts_total", "counter",
+             "Locks never confirmed within the time-out.");
+  for (i = -1; ++i < lk_count; )
+  {
+    put ("xautolock_lock_timeouts_total{command=\"%s\"} %lu\n",
+         lockKindNames[i], lockTimeouts[i]);
+  }
+
+  putHeader ("session_freezes_total", "counter",
+             "Times the session got frozen.");
+  put ("xautolock_session_freezes_total %lu\n", sessionStatistics.freezes);
+
+  putHeader ("session_freeze_seconds_total", "counter",
+             "Time taken by freezing the session.");
+  put ("xautolock_session_freeze_seconds_total %.6f\n",
+       sessionStatistics.freezeUsec / 1e6);
+
+  putHeader ("session_thaw_seconds_total", "counter",
+             "Time taken by thawing the session.");
+  put ("xautolock_session_thaw_seconds_total %.6f\n",
+       sessionStatistics.thawUsec / 1e6);
+
+  putHeader ("session_frozen_seconds_total", "counter",
+             "Time the session spent frozen.");
+  put ("xautolock_session_frozen_seconds_total %.3f\n",
+       sessionStatistics.frozenMsec / 1000.0);
+
+  putHeader ("session_cpu_reclaimed_seconds_total", "counter",
+             "CPU time the session would have used while frozen.");
+  put ("xautolock_session_cpu_reclaimed_seconds_total %.3f\n",
+       sessionStatistics.reclaimedMsec / 1000.0);
+
+  putHeader ("session_demotions_total", "counter",
+             "Times the session got demoted while locked.");
+  put ("xautolock_session_demotions_total %lu\n",
+       sessionStatistics.demotions);
+
+  putHeader ("session_demoted_processes_total", "counter",
+             "Processes affected by those demotions.");
+  put ("xautolock_session_demoted_processes_total %lu\n",
+       sessionStatistics.demotedProcs);
+
+  putHeader ("session_demote_seconds_total", "counter",
+             "Time taken by demoting the session.");
+  put ("xautolock_session_demote_seconds_total %.6f\n",
+       sessionStatistics.demoteUsec / 1e6);
+
+  putHeader ("session_restore_seconds_total", "counter",
+             "Time taken by restoring the session's priority.");
+  put ("xautolock_session_restore_seconds_total %.6f\n",
+       sessionStatistics.restoreUsec / 1e6);
+
+  putHeader ("session_restore_failures_total", "counter",
+             "Threads or cgroup files whose priority couldn't be restored.");
+  put ("xautolock_session_restore_failures_total %lu\n",
+       sessionStatistics.restoreFailures);
+
+  putHeader ("session_reclaims_total", "counter",
+             "Times the memory of a locked session got reclaimed.");
+  put ("xautolock_session_reclaims_total %lu\n",
+       sessionStatistics.reclaims);
+
+  putHeader ("session_reclaims_stopped_total", "counter",
+             "Same, but cut short by user activity.");
+  put ("xautolock_session_reclaims_stopped_total %lu\n",
+       sessionStatistics.reclaimsStopped);
+
+  putHeader ("session_reclaimed_pages_total", "counter",
+             "Anonymous pages paged out by those reclaims.");
+  put ("xautolock_session_reclaimed_pages_total %lu\n",
+       sessionStatistics.reclaimedPages);
+
+  putHeader ("session_reclaim_seconds_total", "counter",
+             "Time spent reclaiming.");
+  put ("xautolock_session_reclaim_seconds_total %.6f\n",
+       sessionStatistics.reclaimUsec / 1e6);
+
+  putHeader ("session_reclaim_failures_total", "counter",
+             "Processes whose memory couldn't be reclaimed.");
+  put ("xautolock_session_reclaim_failures_total %lu\n",
+       sessionStatistics.reclaimFailures);
+
+  putHeader ("memory_pressure_level", "gauge",
+             "Memory pressure: 0 for none, 1 for some, 2 for full.");
+  put ("xautolock_memory_pressure_level %d\n", (int) pressure ());
+
+  putHeader ("memory_pressure_events_total", "counter",
+             "Memory pressure triggers that fired.");
+  put ("xautolock_memory_pressure_events_total %lu\n",
+       pressureStatistics.events);
+
+  putHeader ("memory_pressure_changes_total", "counter",
+             "Memory pressure level changes.");
+  put ("xautolock_memory_pressure_changes_total %lu\n",
+       pressureStatistics.changes);
+
+  putHeader ("kill_delay_seconds", "gauge",
+             "Time after locking at which the killer runs, given the "
+             "pressure.");
+  put ("xautolock_kill_delay_seconds %ld\n", (long) killDelay ());
+
+  putHeader ("stagger_launches_total", "counter",
+             "Lockers started from the lock timer while staggering.");
+  put ("xautolock_stagger_launches_total %lu\n",
+       staggerStatistics.launches);
+
+  putHeader ("stagger_deferrals_total", "counter",
+             "Times the locker was held back for other instances.");
+  put ("xautolock_stagger_deferrals_total %lu\n",
+       staggerStatistics.deferrals);
+
+  putHeader ("stagger_staggered_total", "counter",
+             "Lockers started late because of that.");
+  put ("xautolock_stagger_staggered_total %lu\n",
+       staggerStatistics.staggered);
+
+  putHeader ("stagger_capped_total", "counter",
+             "Same, but started at the -stagger limit regardless.");
+  put ("xautolock_stagger_capped_total %lu\n", staggerStatistics.capped);
+
+  putHeader ("stagger_delay_seconds_total", "counter",
+             "Summed delay of the lockers started late.");
+  put ("xautolock_stagger_delay_seconds_total %.3f\n",
+       staggerStatistics.delayed / 1000.0);
+
+  putHeader ("stagger_max_delay_seconds", "gauge",
+             "Longest delay of a locker started late.");
+  put ("xautolock_stagger_max_delay_seconds %.3f\n",
+       staggerStatistics.maxDelayed / 1000.0);
+
+  putHeader ("diy_queue_depth", "gauge",
+             "Windows waiting to be watched in DIY mode.");
+  put ("xautolock_diy_queue_depth %lu\n", metrics.diyQueueDepth);
+
+  putHeader ("idle_seconds", "gauge", "Time since the last user activity.");
+  put ("xautolock_idle_seconds %.3f\n",
+       (monotonicNow () - metrics.lastActivity) / 1000.0);
+}
+
+/*
+ *  Watch handler. Whoever connects gets the page and is hung up on.
+ *  The page is small enough to fit in the socket buffer, so this
+ *  never blocks.
+ */
+static Bool
+metricsWanted (Display* d, int fd)
+{
+  int client; /* as it says */
+
+  if ((client = accept (fd, 0, 0)) < 0) return False; /* = intended */
+
+  buildPage ();
+  (void) send (client, page, pageLength, MSG_DONTWAIT | MSG_NOSIGNAL);
+  (void) close (client);
+
+  return False;
+}
+#endif /* VMS */
+
+/*
+ *  Function for setting up the socket. Complains and carries on
+ *  without it if that doesn't work.
+ */
+void
+initMetrics (void)
+{
+#ifndef VMS
+  struct sockaddr_un address; /* as it says */
+  struct stat        info;    /* as it says */
+
+  metrics.lastActivity = monotonicNow ();
+
+  if (!*metricsPath) return;
+
+  if (strlen (metricsPath) >= sizeof (address.sun_path))
+  {
+    error1 ("Metrics socket name %s is too long.\n", metricsPath);
+    return;
+  }
+
+  (void) memset (&address, 0, sizeof (address));
+  address.sun_family = AF_UNIX;
+  (void) strcpy (address.sun_path, metricsPath);
+
+ /*
+  *  Get rid of whatever a previous incarnation left behind, but
+  *  don't go removing anything that isn't a socket.
+  */
+  if (!lstat (metricsPath, &info) && S_ISSOCK (info.st_mode))
+  {
+    (void) unlink (metricsPath);
+  }
+
+  if (   (listenFd = socket (AF_UNIX, SOCK_STREAM, 0)) < 0 /* = intended */
+      || fcntl (listenFd, F_SETFD, FD_CLOEXEC)
+      || fcntl (listenFd, F_SETFL, O_NONBLOCK)
+      || bind (listenFd, (struct sockaddr*) &address, sizeof (address))
+      || listen (listenFd, 4)
+      || !addWatch (listenFd, metricsWanted))
+  {
+    error1 ("Can't serve metrics on %s.\n", metricsPath);
+    if (listenFd >= 0) (void) close (listenFd);
+    listenFd = -1;
+  }
+#endif /* VMS */
+}
+
+void
+cleanupMetrics (void)
+{
+#ifndef VMS
+  if (listenFd >= 0)
+  {
+    removeWatch (listenFd);
+    (void) close (listenFd);
+    (void) unlink (metricsPath);
+    listenFd = -1;
+  }
+#endif /* VMS */
+}
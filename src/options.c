@@ -20,6 +20,10 @@
 
 #include "options.h"
 #include "state.h"
+#include "launch.h"
+#include "session.h"
+#include "stagger.h"
+#include "prespawn.h"
 #include "miscutil.h"
 #include "version.h"
 
@@ -30,8 +34,15 @@ const char*  locker = LOCKER;            /* as it says                  */
 const char*  nowLocker = LOCKER;         /* as it says                  */
 const char*  notifier = NOTIFIER;        /* as it says                  */
 const char*  killer = KILLER;            /* as it says                  */
+const char*  authHelper = "";            /* as it says                  */
+const char*  metricsPath = "";           /* socket to serve metrics on  */
+const char*  profilePath = "";           /* file to write profile to    */
+const char*  cgroupDir = "";             /* cgroup holding the session  */
 time_t       lockTime = LOCK_MINS;       /* as it says                  */
 time_t       killTime = KILL_MINS;       /* as it says                  */
+time_t       minKillTime = 0;            /* kill time under memory
+                                            pressure, 0 for killTime    */
+time_t       maxKillTime = 0;            /* same without any pressure   */
 time_t       notifyMargin;               /* as it says                  */
 Bool         secure = SECURE;            /* as it says                  */
 int          bellPercent = BELL_PERCENT; /* as it says                  */
@@ -54,6 +65,30 @@ Bool         detectSleep = False;        /* whether to reset the timers
 					    i.e. after a big time jump  */
 const char*  id = ID;                    /* used to distinguish between
                                             different processes         */
+Bool         useShell = False;           /* whether to always run commands
+                                            through /bin/sh             */
+time_t       hookTimeout = HOOK_TIMEOUT; /* as it says                  */
+int          maxHooks = MAX_HOOKS;       /* as it says                  */
+Bool         captureHooks = False;       /* whether to keep the stderr
+                                            output of hooks             */
+Bool         builtinLocker = False;      /* whether to lock ourselves   */
+backendType  backend = bk_auto;          /* how to detect activity      */
+int          maxRoundTrips = 0;          /* max. polling round trips per
+                                            minute, 0 for no limit      */
+Bool         useFreezer = False;         /* whether to freeze the
+                                            session at kill time        */
+Bool         useDemotion = False;        /* whether to lower the
+                                            session's priority while
+                                            locked                      */
+Bool         measureLocks = False;       /* whether to keep track of how
+                                            long locking takes          */
+Bool         prespawn = False;           /* whether to get the locker
+                                            ready before locking        */
+time_t       staggerMax = 0;             /* how long other instances may
+                                            hold back the locker        */
+time_t       reclaimTime = 0;            /* time after locking at which to
+                                            reclaim the session's memory,
+                                            0 for never                 */
 
 #ifdef VMS
 struct dsc$descriptor lockerDescr;       /* used to fire up the locker  */
@@ -63,11 +98,13 @@ int                   vmsStatus = 1;     /* locker completion status    */
 
 Bool         notifierSpecified = False;  
 Bool         killerSpecified = False;
+Bool         authHelperSpecified = False;
 
 /*
  *  Guess what, these are private.
  */
 static Bool killTimeSpecified = False;
+static Bool pressureSpecified = False;
 static Bool redelaySpecified = False;
 static Bool bellSpecified = False;
 static Bool dummySpecified;
@@ -130,6 +167,14 @@ killerAction (Display* d, const char* arg)
   return True;
 }
 
+static Bool
+authHelperAction (Display* d, const char* arg)
+{
+  authHelperSpecified = True;
+  authHelper = arg;
+  return True;
+}
+
 static Bool
 notifierAction (Display* d, const char* arg)
 {
@@ -180,6 +225,18 @@ cornersAction (Display* d, const char* arg)
   return True;
 }
 
+static Bool
+maxHooksAction (Display* d, const char* arg)
+{
+  return getPositive (arg, &maxHooks);
+}
+
+static Bool
+roundTripsAction (Display* d, const char* arg)
+{
+  return getPositive (arg, &maxRoundTrips);
+}
+
 static Bool
 idAction (Display* d, const char* arg)
 {
@@ -187,6 +244,39 @@ idAction (Display* d, const char* arg)
   return True;
 }
 
+static Bool
+metricsAction (Display* d, const char* arg)
+{
+  metricsPath = arg;
+  return True;
+}
+
+static Bool
+profileAction (Display* d, const char* arg)
+{
+  profilePath = arg;
+  return True;
+}
+
+static Bool
+cgroupAction (Display* d, const char* arg)
+{
+  cgroupDir = arg;
+  return True;
+}
+
+static Bool
+backendAction (Display* d, const char* arg)
+{
+  if      (!strcmp (arg, "auto"))  backend = bk_auto;
+  else if (!strcmp (arg, "xidle")) backend = bk_xidle;
+  else if (!strcmp (arg, "mit"))   backend = bk_mit;
+  else if (!strcmp (arg, "diy"))   backend = bk_diy;
+  else                             return False;
+
+  return True;
+}
+
 #define TIME_ACTION(name,nameSpecified)                    \
 static Bool                                                \
 name##Action (Display* d, const char* arg)                 \
@@ -205,9 +295,14 @@ name##Action (Display* d, const char* arg)                 \
 
 TIME_ACTION (lockTime     , dummySpecified   )
 TIME_ACTION (killTime     , killTimeSpecified)
+TIME_ACTION (minKillTime  , pressureSpecified)
+TIME_ACTION (maxKillTime  , pressureSpecified)
 TIME_ACTION (cornerDelay  , dummySpecified   )
 TIME_ACTION (cornerRedelay, redelaySpecified )
 TIME_ACTION (notifyMargin , notifyLock       )
+TIME_ACTION (hookTimeout  , dummySpecified   )
+TIME_ACTION (reclaimTime  , dummySpecified   )
+TIME_ACTION (staggerMax   , dummySpecified   )
 
 #define notifyAction notifyMarginAction
 
@@ -228,6 +323,8 @@ MESSAGE_ACTION (lockNow  )
 MESSAGE_ACTION (unlockNow)
 MESSAGE_ACTION (restart  )
 MESSAGE_ACTION (isDisabled)
+MESSAGE_ACTION (dumpTrace)
+MESSAGE_ACTION (lockLatency)
 
 #define BOOL_ACTION(name)                  \
 static Bool                                \
@@ -241,6 +338,13 @@ BOOL_ACTION (resetSaver)
 BOOL_ACTION (noCloseOut)
 BOOL_ACTION (noCloseErr)
 BOOL_ACTION (detectSleep)
+BOOL_ACTION (useShell   )
+BOOL_ACTION (captureHooks)
+BOOL_ACTION (builtinLocker)
+BOOL_ACTION (useFreezer )
+BOOL_ACTION (useDemotion)
+BOOL_ACTION (measureLocks)
+BOOL_ACTION (prespawn   )
 
 static Bool
 noCloseAction (Display* d, const char* arg)
@@ -253,28 +357,6 @@ noCloseAction (Display* d, const char* arg)
 /*
  *  Option checking logistics.
  */
-#ifndef VMS
-static void
-addExecToCommand (const char** command)
-{
- /*
-  *  On UNIX systems, we dont want to have an extra shell process 
-  *  hanging about all the time while the locker is running, so we
-  *  want to insert an `exec' in front of the command. But since
-  *  this obviuosly would fail to work correctly if the command
-  *  actually consists of multiple ones, we need to look for `;'
-  *  characters first. We can only err on the safe side here...
-  */
-  if (!strchr (*command, ';'))
-  {
-    char* tmp;
-    (void) sprintf (tmp = newArray (char, strlen (*command) + 6),
-		    "exec %s", *command);
-    *command = tmp;
-  }
-}
-#endif /* !VMS */
-
 static void 
 lockTimeChecker (Display* d)
 {
@@ -295,9 +377,9 @@ lockTimeChecker (Display* d)
 static void
 killTimeChecker (Display* d)
 {
-  if (killTimeSpecified && !killerSpecified)
+  if (killTimeSpecified && !killerSpecified && !useFreezer)
   {
-    error0 ("Using -killtime without -killer makes no sense.\n");
+    error0 ("Using -killtime without -killer or -freeze makes no sense.\n");
     return;
   }
  
@@ -315,12 +397,67 @@ killTimeChecker (Display* d)
   killTime *= 60; /* convert to seconds */
 }
 
+static void
+killBoundsChecker (Display* d)
+{
+  time_t mins = killTime / 60; /* -killtime, already checked */
+
+  if (!pressureSpecified) return;
+
+#ifndef __linux__
+  error0 ("Scaling the kill time is only available on Linux.\n");
+  minKillTime = maxKillTime = 0;
+  return;
+#endif /* __linux__ */
+
+  if (!killerSpecified && !useFreezer)
+  {
+    error0 ("Using -minkilltime or -maxkilltime without -killer or "
+            "-freeze makes no sense.\n");
+    minKillTime = maxKillTime = 0;
+    return;
+  }
+
+  if (!minKillTime)
+  {
+    minKillTime = mins;
+  }
+  else if (minKillTime < MIN_KILL_MINS)
+  {
+    error1 ("Setting minimum kill time to minimum value of %ld "
+            "minute(s).\n", (long) (minKillTime = MIN_KILL_MINS));
+  }
+  else if (minKillTime > mins)
+  {
+    error1 ("Setting minimum kill time to kill time of %ld minute(s).\n",
+            (long) (minKillTime = mins));
+  }
+
+  if (!maxKillTime)
+  {
+    maxKillTime = mins;
+  }
+  else if (maxKillTime > MAX_KILL_MINS)
+  {
+    error1 ("Setting maximum kill time to maximum value of %ld "
+            "minute(s).\n", (long) (maxKillTime = MAX_KILL_MINS));
+  }
+  else if (maxKillTime < mins)
+  {
+    error1 ("Setting maximum kill time to kill time of %ld minute(s).\n",
+            (long) (maxKillTime = mins));
+  }
+
+  minKillTime *= 60; /* convert to seconds */
+  maxKillTime *= 60; /* same               */
+}
+
 static void
 lockerChecker (Display* d)
 {
-#ifndef VMS
-  addExecToCommand (&locker);
-#else /* VMS */
+  prepareCommand (cmd_locker, locker);
+
+#ifdef VMS
  /*
   *  Translate things to something that VMS knows how to handle.
   */
@@ -334,9 +471,9 @@ lockerChecker (Display* d)
 static void
 nowLockerChecker (Display* d)
 {
-#ifndef VMS
-  addExecToCommand (&nowLocker);
-#else /* VMS */
+  prepareCommand (cmd_nowLocker, nowLocker);
+
+#ifdef VMS
  /*
   *  Translate things to something that VMS knows how to handle.
   */
@@ -356,40 +493,54 @@ notifierChecker (Display* d)
     {
       error0 ("Using -notifier without -notify makes no sense.\n");
     }
-#ifndef VMS
     else
     {
-     /*
-      *  Add an `&' to the notifier command, so that it always gets 
-      *  run as a background process and things will work out properly 
-      *  later. The rationale behind this hack is explained elsewhere.
-      */
-      char* tmp;
-      (void) sprintf (tmp = newArray (char, strlen (notifier) + 3),
-		      "%s &", notifier);
-      notifier = tmp;
+      prepareCommand (cmd_notifier, notifier);
     }
-#endif /* !VMS */
   }
 }
 
 static void
 killerChecker (Display* d)
 {
-#ifndef VMS
   if (strcmp (killer, ""))
   {
-   /*
-    *  Add an `&' to the killer command, so that it always gets 
-    *  run as a background process and things will work out properly 
-    *  later. The rationale behind this hack is explained elsewhere.
-    */
-    char* tmp;
-    (void) sprintf (tmp = newArray (char, strlen (killer) + 3),
-		    "%s &", killer);
-    killer = tmp;
+    prepareCommand (cmd_killer, killer);
   }
-#endif /* !VMS */
+}
+
+static void
+authHelperChecker (Display* d)
+{
+  if (authHelperSpecified)
+  {
+    if (!builtinLocker)
+    {
+      error0 ("Using -authhelper without -builtinlocker makes no sense.\n");
+    }
+
+    prepareCommand (cmd_authHelper, authHelper);
+  }
+}
+
+static void
+builtinLockerChecker (Display* d)
+{
+#ifndef HasPam
+  if (builtinLocker && !authHelperSpecified)
+  {
+    error0 ("No PAM support, -builtinlocker needs -authhelper.\n");
+    builtinLocker = False;
+  }
+#endif /* HasPam */
+
+#ifdef VMS
+  if (builtinLocker)
+  {
+    error0 ("The built-in locker is not available on VMS.\n");
+    builtinLocker = False;
+  }
+#endif /* VMS */
 }
 
 static void
@@ -467,6 +618,140 @@ cornerSizeChecker (Display* d)
   }
 }
 
+static void
+maxHooksChecker (Display* d)
+{
+  if (maxHooks < 1)
+  {
+    error1 ("Setting number of hooks to minimum value of %d.\n",
+            maxHooks = 1);
+  }
+  else if (maxHooks > MAX_HOOK_JOBS)
+  {
+    error1 ("Setting number of hooks to maximum value of %d.\n",
+            maxHooks = MAX_HOOK_JOBS);
+  }
+}
+
+static void
+roundTripsChecker (Display* d)
+{
+  if (maxRoundTrips && maxRoundTrips < MIN_ROUND_TRIPS)
+  {
+    error1 ("Setting round trips to minimum value of %d.\n",
+            maxRoundTrips = MIN_ROUND_TRIPS);
+  }
+}
+
+static void
+cgroupChecker (Display* d)
+{
+  if (!*cgroupDir) return;
+
+  if (access (cgroupDir, R_OK | X_OK))
+  {
+    error1 ("Can't get at cgroup %s, not using it.\n", cgroupDir);
+    cgroupDir = "";
+  }
+  else if (useFreezer && cgroupHoldsUs (cgroupDir))
+  {
+    error1 ("Cgroup %s holds xautolock itself, not freezing it.\n",
+            cgroupDir);
+    useFreezer = False;
+  }
+}
+
+static void
+freezeChecker (Display* d)
+{
+#ifndef __linux__
+  if (useFreezer)
+  {
+    error0 ("Freezing is only available on Linux.\n");
+    useFreezer = False;
+  }
+#endif /* __linux__ */
+}
+
+static void
+demoteChecker (Display* d)
+{
+  if (!useDemotion) return;
+
+#ifndef __linux__
+  error0 ("Demoting is only available on Linux.\n");
+  useDemotion = False;
+#else /* __linux__ */
+  if (!*cgroupDir && !canRestoreNice (0))
+  {
+    error0 ("Without -cgroup or a higher RLIMIT_NICE, demoting only "
+            "lowers the I/O\npriority, as nice values couldn't be put "
+            "back.\n");
+  }
+#endif /* __linux__ */
+}
+
+static void
+reclaimChecker (Display* d)
+{
+  if (!reclaimTime) return;
+
+#ifndef HasReclaim
+  error0 ("Reclaiming memory is only available on Linux 5.10 and up.\n");
+  reclaimTime = 0;
+#else /* HasReclaim */
+  if (!hasSysNice ())
+  {
+    error0 ("Reclaiming memory of other processes takes CAP_SYS_NICE, "
+            "not reclaiming.\n");
+    reclaimTime = 0;
+    return;
+  }
+
+  if (reclaimTime < MIN_RECLAIM_MINS)
+  {
+    error1 ("Setting reclaim time to minimum value of %ld minute(s).\n",
+            (long) (reclaimTime = MIN_RECLAIM_MINS));
+  }
+
+  reclaimTime *= 60; /* convert to seconds */
+#endif /* HasReclaim */
+}
+
+static void
+prespawnChecker (Display* d)
+{
+  if (!prespawn) return;
+
+#ifndef HasPrespawn
+  error0 ("Prespawning the locker is not available on this platform.\n");
+  prespawn = False;
+#else /* HasPrespawn */
+  if (builtinLocker)
+  {
+    error0 ("The built-in locker needs no prespawning.\n");
+    prespawn = False;
+  }
+#endif /* HasPrespawn */
+}
+
+static void
+staggerChecker (Display* d)
+{
+  if (!staggerMax) return;
+
+#ifndef HasStagger
+  error0 ("Staggering is not available on this platform.\n");
+  staggerMax = 0;
+#else /* HasStagger */
+  if (staggerMax > MAX_STAGGER)
+  {
+    error1 ("Setting stagger time to maximum value of %ld second(s).\n",
+            (long) (staggerMax = MAX_STAGGER));
+  }
+#endif /* HasStagger */
+}
+
 static void
 cornerReDelayChecker (Display* d)
 {
@@ -513,6 +798,10 @@ static struct
     cornerRedelayAction, cornerReDelayChecker      },
   {"killtime"          , XrmoptionSepArg, (caddr_t) 0 ,
     killTimeAction     , killTimeChecker           },
+  {"minkilltime"       , XrmoptionSepArg, (caddr_t) 0 ,
+    minKillTimeAction  , (optChecker) 0            },
+  {"maxkilltime"       , XrmoptionSepArg, (caddr_t) 0 ,
+    maxKillTimeAction  , killBoundsChecker         },
   {"time"              , XrmoptionSepArg, (caddr_t) 0 ,
     lockTimeAction     , lockTimeChecker           },
   {"notify"            , XrmoptionSepArg, (caddr_t) 0 ,
@@ -539,6 +828,12 @@ static struct
     restartAction      , (optChecker) 0            },
   {"isdisabled"        , XrmoptionNoArg , (caddr_t) "",
     isDisabledAction   , (optChecker) 0            },
+  {"dumptrace"         , XrmoptionNoArg , (caddr_t) "",
+    dumpTraceAction    , (optChecker) 0            },
+  {"locklatency"       , XrmoptionNoArg , (caddr_t) "",
+    lockLatencyAction  , (optChecker) 0            },
+  {"measurelocks"      , XrmoptionNoArg , (caddr_t) "",
+    measureLocksAction , (optChecker) 0            },
   {"resetsaver"        , XrmoptionNoArg , (caddr_t) "",
     resetSaverAction   , (optChecker) 0            },
   {"noclose"           , XrmoptionNoArg , (caddr_t) "",
@@ -549,6 +844,38 @@ static struct
     noCloseErrAction   , (optChecker) 0            },
   {"detectsleep"       , XrmoptionNoArg , (caddr_t) "",
     detectSleepAction  , (optChecker) 0            },
+  {"shell"             , XrmoptionNoArg , (caddr_t) "",
+    useShellAction     , (optChecker) 0            },
+  {"hooktimeout"       , XrmoptionSepArg, (caddr_t) 0 ,
+    hookTimeoutAction  , (optChecker) 0            },
+  {"maxhooks"          , XrmoptionSepArg, (caddr_t) 0 ,
+    maxHooksAction     , maxHooksChecker           },
+  {"capturehooks"      , XrmoptionNoArg , (caddr_t) "",
+    captureHooksAction , (optChecker) 0            },
+  {"builtinlocker"     , XrmoptionNoArg , (caddr_t) "",
+    builtinLockerAction, builtinLockerChecker      },
+  {"authhelper"        , XrmoptionSepArg, (caddr_t) 0 ,
+    authHelperAction   , authHelperChecker         },
+  {"metrics"           , XrmoptionSepArg, (caddr_t) 0 ,
+    metricsAction      , (optChecker) 0            },
+  {"profile"           , XrmoptionSepArg, (caddr_t) 0 ,
+    profileAction      , (optChecker) 0            },
+  {"backend"           , XrmoptionSepArg, (caddr_t) 0 ,
+    backendAction      , (optChecker) 0            },
+  {"roundtrips"        , XrmoptionSepArg, (caddr_t) 0 ,
+    roundTripsAction   , roundTripsChecker         },
+  {"freeze"            , XrmoptionNoArg , (caddr_t) "",
+    useFreezerAction   , freezeChecker             },
+  {"demote"            , XrmoptionNoArg , (caddr_t) "",
+    useDemotionAction  , demoteChecker             },
+  {"reclaim"           , XrmoptionSepArg, (caddr_t) 0 ,
+    reclaimTimeAction  , reclaimChecker            },
+  {"stagger"           , XrmoptionSepArg, (caddr_t) 0 ,
+    staggerMaxAction   , staggerChecker            },
+  {"prespawn"          , XrmoptionNoArg , (caddr_t) "",
+    prespawnAction     , prespawnChecker           },
+  {"cgroup"            , XrmoptionSepArg, (caddr_t) 0 ,
+    cgroupAction       , cgroupChecker             },
 }; /* as it says, the order is important! */
 
 /*
@@ -574,13 +901,20 @@ usage (int exitCode)
   error1 ("Usage : %s ", progName);
   error0 ("[-help][-version][-time mins][-locker locker]\n");
   error1 ("%s[-killtime mins][-killer killer]\n", blanks);
+  error1 ("%s[-minkilltime mins][-maxkilltime mins]\n", blanks);
   error1 ("%s[-notify margin][-notifier notifier][-bell percent]\n", blanks);
   error1 ("%s[-corners xxxx][-cornerdelay secs]\n", blanks);
   error1 ("%s[-cornerredelay secs][-cornersize pixels][-id id]\n", blanks);
   error1 ("%s[-nocloseout][-nocloseerr][-noclose]\n", blanks);
   error1 ("%s[-enable][-disable][-toggle][-exit][-isdisabled]\n", blanks);
   error1 ("%s[-locknow][-unlocknow][-nowlocker locker][-secure]\n", blanks);
-  error1 ("%s[-restart][-resetsaver][-detectsleep]\n", blanks);
+  error1 ("%s[-restart][-resetsaver][-detectsleep][-shell]\n", blanks);
+  error1 ("%s[-hooktimeout secs][-maxhooks n][-capturehooks]\n", blanks);
+  error1 ("%s[-builtinlocker][-authhelper helper]\n", blanks);
+  error1 ("%s[-backend backend][-metrics socket][-profile file]\n", blanks);
+  error1 ("%s[-roundtrips n][-dumptrace][-locklatency]\n", blanks);
+  error1 ("%s[-measurelocks][-stagger secs][-prespawn]\n", blanks);
+  error1 ("%s[-freeze][-demote][-reclaim mins][-cgroup dir]\n", blanks);
 
   error0 ("\n");
   error0 (" -help               : print this message and exit.\n");
@@ -593,6 +927,8 @@ usage (int exitCode)
   error2 ("                       the killer [%d <= killmins <= %d].\n",
                                   MIN_KILL_MINS, MAX_KILL_MINS);
   error0 (" -killer killer      : program used to kill.\n");
+  error0 (" -minkilltime mins   : kill time under heavy memory pressure.\n");
+  error0 (" -maxkilltime mins   : kill time without memory pressure.\n");
   error0 (" -notify margin      : notify this many seconds before locking.\n");
   error0 (" -notifier notifier  : program used to notify.\n");
   error0 (" -bell percent       : loudness of notification beeps.\n");
@@ -618,6 +954,39 @@ usage (int exitCode)
   error0 (" -resetsaver         : reset the screensaver when starting "
                                   "the locker.\n");
   error0 (" -detectsleep        : reset timers when awaking from sleep.\n");
+  error0 (" -shell              : always run commands through /bin/sh.\n");
+  error0 (" -hooktimeout secs   : kill the notifier or killer after this\n");
+  error0 ("                       many seconds.\n");
+  error0 (" -maxhooks n         : run at most n notifiers or killers at");
+  error1 (" once [1 <= n <= %d].\n", MAX_HOOK_JOBS);
+  error0 (" -capturehooks       : keep the notifier and killer output.\n");
+  error0 (" -builtinlocker      : lock the screen without a locker.\n");
+  error0 (" -authhelper helper  : program used by the built-in locker to\n");
+  error0 ("                       check the password.\n");
+  error0 (" -backend backend    : how to detect activity: auto, xidle,\n");
+  error0 ("                       mit or diy.\n");
+  error0 (" -metrics socket     : serve metrics on this UNIX socket.\n");
+  error0 (" -profile file       : append main loop profile to this file.\n");
+  error0 (" -roundtrips n       : poll the server with at most n round\n");
+  error1 ("                       trips per minute [n >= %d].\n",
+                                  MIN_ROUND_TRIPS);
+  error0 (" -dumptrace          : tell a running xautolock to dump its\n");
+  error0 ("                       flight recorder.\n");
+  error0 (" -locklatency        : ask a running xautolock how long it\n");
+  error0 ("                       takes to lock.\n");
+  error0 (" -measurelocks       : keep track of how long it takes to lock.\n");
+  error0 (" -stagger secs       : hold back the locker at most this long\n");
+  error0 ("                       if many others start at the same time.\n");
+  error0 (" -prespawn           : get a cooperating locker ready before\n");
+  error0 ("                       locking.\n");
+  error0 (" -freeze             : freeze the session instead of, or as\n");
+  error0 ("                       well as, running the killer.\n");
+  error0 (" -demote             : lower the session's priority while\n");
+  error0 ("                       locked.\n");
+  error0 (" -reclaim mins       : page out the session's memory after\n");
+  error1 ("                       being locked this long [mins >= %d].\n",
+                                  MIN_RECLAIM_MINS);
+  error0 (" -cgroup dir         : cgroup holding the session.\n");
 
   error0 ("\n");
   error0 ("Defaults :\n");
@@ -628,6 +997,8 @@ usage (int exitCode)
   error1 ("  nowlocker     : %s\n"          , LOCKER      );
   error1 ("  killtime      : %d minutes\n"  , KILL_MINS   );
   error0 ("  killer        : none\n"                      );
+  error0 ("  minkilltime   : killtime\n"                  );
+  error0 ("  maxkilltime   : killtime\n"                  );
   error0 ("  notify        : don't notify\n"              );
   error0 ("  notifier      : none\n"                      );
   error1 ("  bell          : %d%%\n"        , BELL_PERCENT);
@@ -635,6 +1006,12 @@ usage (int exitCode)
   error1 ("  cornerdelay   : %d seconds\n"  , CORNER_DELAY);
   error1 ("  cornerredelay : %d seconds\n"  , CORNER_DELAY);
   error1 ("  cornersize    : %d pixels\n"   , CORNER_SIZE );
+  error0 ("  hooktimeout   : none\n"                      );
+  error1 ("  maxhooks      : %d\n"          , MAX_HOOKS   );
+  error0 ("  roundtrips    : no limit\n"              );
+  error0 ("  reclaim       : don't reclaim\n"             );
+  error0 ("  stagger       : don't stagger\n"             );
+  error0 ("  cgroup        : none, use the session id\n"  );
 
   error0 ("\n");
   error1 ("Version : %s\n", VERSION);
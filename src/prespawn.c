@@ -0,0 +1,226 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          the stuff used to get the locker ready before it is needed.
+ *
+ *          Most of the time it takes to lock goes into the locker
+ *          setting itself up: loading its libraries, connecting to the
+ *          X server, allocating its windows and the like. There is no
+ *          way to do that on its behalf, but a locker that is in on it
+ *          can be started a few seconds early and do all of that, and
+ *          then wait for the word to go ahead. That is what -prespawn
+ *          is about. The locker gets one end of a socket as its stdin
+ *          and PRESPAWN_ENV in its environment. It writes one byte to
+ *          say it is ready, and then reads one. Getting one means lock
+ *          now, end-of-file means it wasn't needed after all and should
+ *          go away without locking.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "prespawn.h"
+#include "options.h"
+#include "state.h"
+#include "launch.h"
+#include "watch.h"
+#include "trace.h"
+#include "miscutil.h"
+
+#include <errno.h>
+
+#ifdef HasPrespawn
+#include <sys/socket.h>
+#endif /* HasPrespawn */
+
+prespawnStats prespawnStatistics; /* as it says */
+
+#ifdef HasPrespawn
+static pid_t warmPid = 0;     /* locker waiting to be told, or 0 */
+static int   warmFd = -1;     /* our end of its stdin            */
+static msecs warmSince;       /* when it was started             */
+static Bool  warmReady;       /* whether it said it was ready    */
+static pid_t strayPid = 0;    /* one sent away, but not yet
+                                 collected                       */
+
+/*
+ *  Function for noticing the waiting locker saying it is ready, or
+ *  giving up. In the latter case, a fresh one will be started at the
+ *  deadline.
+ */
+static Bool
+lockerReady (Display* d, int fd)
+{
+  ssize_t got; /* as it says */
+  char    c;   /* as it says */
+  msecs   now; /* as it says */
+
+  if ((got = read (fd, &c, 1)) < 0 && errno == EAGAIN) return False;
+
+  removeWatch (fd);
+
+  if (got == 1)
+  {
+    now = monotonicNow ();
+    warmReady = True;
+    ++prespawnStatistics.ready;
+    prespawnStatistics.setup += now - warmSince;
+    prespawnStatistics.ahead += lockDeadline () - now;
+    trace (tr_prespawn, ps_ready, warmPid);
+  }
+  else
+  {
+    cancelPrespawn ();
+  }
+
+  return False;
+}
+#endif /* HasPrespawn */
+
+/*
+ *  Function for starting the locker ahead of time. Only one of them
+ *  is ever around, and none while the previous one has yet to go.
+ */
+void
+prespawnLocker (void)
+{
+#ifdef HasPrespawn
+  int fds[2]; /* socket, so that we don't get SIGPIPE-d */
+
+  checkPrespawn ();
+  if (warmPid || strayPid) return;
+
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, fds)) return;
+
+  (void) fcntl (fds[0], F_SETFD, FD_CLOEXEC);
+  (void) fcntl (fds[1], F_SETFD, FD_CLOEXEC);
+  (void) fcntl (fds[1], F_SETFL, O_NONBLOCK);
+
+  (void) setenv (PRESPAWN_ENV, "1", 1);
+  warmPid = launchCommand (cmd_locker, fds[0], -1);
+  (void) unsetenv (PRESPAWN_ENV);
+  (void) close (fds[0]);
+
+  if (!warmPid)
+  {
+    (void) close (fds[1]);
+    return;
+  }
+
+  warmFd = fds[1];
+  warmSince = monotonicNow ();
+  warmReady = False;
+  (void) addWatch (warmFd, lockerReady);
+
+  ++prespawnStatistics.started;
+  trace (tr_prespawn, ps_started, warmPid);
+#endif /* HasPrespawn */
+}
+
+/*
+ *  Function for telling the waiting locker to lock, if there is one.
+ *  Returns its process id, or 0 if there is none (or no longer one),
+ *  in which case the caller should start one the normal way.
+ */
+pid_t
+takePrespawned (void)
+{
+#ifdef HasPrespawn
+  pid_t pid = warmPid; /* as it says */
+
+  if (!warmPid) return 0;
+
+  if (send (warmFd, "l", 1, MSG_NOSIGNAL) != 1)
+  {
+    cancelPrespawn ();
+    return 0;
+  }
+
+  removeWatch (warmFd);
+  (void) close (warmFd);
+  warmFd = -1;
+  warmPid = 0;
+
+  ++prespawnStatistics.used;
+  if (!warmReady) ++prespawnStatistics.late;
+  trace (tr_prespawn, ps_used, pid);
+  return pid;
+#else /* HasPrespawn */
+  return 0;
+#endif /* HasPrespawn */
+}
+
+/*
+ *  Function for sending the waiting locker away, if there is one.
+ *  Closing the socket is all it should need, the SIGTERM is for
+ *  lockers still busy setting up. It gets collected later.
+ */
+void
+cancelPrespawn (void)
+{
+#ifdef HasPrespawn
+  if (!warmPid) return;
+
+  removeWatch (warmFd);
+  (void) close (warmFd);
+  warmFd = -1;
+  (void) kill (warmPid, SIGTERM);
+
+  ++prespawnStatistics.cancelled;
+  trace (tr_prespawn, ps_cancelled, warmPid);
+  strayPid = warmPid;
+  warmPid = 0;
+  checkPrespawn ();
+#endif /* HasPrespawn */
+}
+
+/*
+ *  Function for collecting a locker that was sent away.
+ */
+void
+checkPrespawn (void)
+{
+#ifdef HasPrespawn
+  int status; /* as it says */
+
+  if (strayPid && waitpid (strayPid, &status, WNOHANG)) strayPid = 0;
+#endif /* HasPrespawn */
+}
+
+/*
+ *  Function for telling the user how well getting the locker ready
+ *  in advance works out.
+ */
+void
+reportPrespawnStats (void)
+{
+  prespawnStats* stats = &prespawnStatistics; /* as it says */
+
+  if (!stats->started) return;
+
+  (void) fprintf (stderr,
+                  "prespawn  : %lu started, %lu ready, %lu used "
+                  "(%lu before ready), %lu cancelled.\n",
+                  stats->started, stats->ready, stats->used, stats->late,
+                  stats->cancelled);
+
+  if (stats->ready)
+  {
+    (void) fprintf (stderr,
+                    "prespawn  : %lld ms to get ready, %lld ms ahead "
+                    "of the deadline on average.\n",
+                    stats->setup / (msecs) stats->ready,
+                    stats->ahead / (msecs) stats->ready);
+  }
+}
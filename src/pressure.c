@@ -0,0 +1,250 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          the stuff used to scale the kill time with memory pressure.
+ *
+ *          The kernel's pressure stall information (PSI) lets us leave
+ *          a trigger in /proc/pressure/memory that fires whenever tasks
+ *          got stalled on memory for more than so long within a window.
+ *          We keep one for "some" and one for "full" stalls. Either one
+ *          raises the pressure level, which shortens the kill time down
+ *          to -minkilltime. When the quiet is long enough for there to
+ *          be no events at all for PSI_EASE milliseconds, it drops one
+ *          level at a time, stretching the kill time up to -maxkilltime
+ *          once there's no pressure left.
+ *
+ *          Triggers signal POLLPRI, which select() would only report as
+ *          an exceptional condition. So each one is put into an epoll
+ *          instance of its own, which simply becomes readable, and that
+ *          is what gets watched.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "pressure.h"
+#include "options.h"
+#include "watch.h"
+#include "trace.h"
+#include "miscutil.h"
+
+#include <errno.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif /* __linux__ */
+
+pressureStats pressureStatistics; /* as it says */
+
+static pressureLevel level = pl_none;  /* as it says                   */
+static msecs         levelSince;       /* when we got there            */
+static Bool          watching = False; /* whether the triggers are set */
+
+#ifdef __linux__
+static struct
+{
+  const char* kind;    /* as in /proc/pressure/memory */
+  int         stall;   /* usecs per window to trigger */
+  int         psiFd;   /* the trigger                 */
+  int         epollFd; /* what we watch instead       */
+} triggers[] =
+{
+  { "some", PSI_SOME, -1, -1 },
+  { "full", PSI_FULL, -1, -1 },
+};
+
+#define nofTriggers (int) (sizeof (triggers) / sizeof (triggers[0]))
+
+/*
+ *  Function for moving to a new pressure level. An armed kill timer
+ *  is moved along, so that it runs as long from when it was set as
+ *  the new kill time says, or expires right away if that's over.
+ */
+static void
+changeLevel (pressureLevel newLevel)
+{
+  msecs  now = monotonicNow ();   /* as it says              */
+  time_t oldDelay = killDelay (); /* kill time at old level */
+
+  pressureStatistics.atLevel[level] += now - levelSince;
+  ++pressureStatistics.changes;
+  levelSince = now;
+  level = newLevel;
+
+  if (timerArmed (tm_kill))
+  {
+    armTimer (tm_kill,   timerDeadline (tm_kill)
+                       + (killDelay () - oldDelay) * 1000);
+  }
+
+  trace (tr_pressure, level, killDelay ());
+}
+
+/*
+ *  Watch handler. Reading from the epoll instance merely clears it,
+ *  the fact that it became readable is all we need to know.
+ */
+static Bool
+pressureChanged (Display* d, int fd)
+{
+  struct epoll_event event; /* as it says   */
+  pressureLevel      l;     /* as it says   */
+  int                t;     /* loop counter */
+
+  (void) epoll_wait (fd, &event, 1, 0);
+
+  for (t = -1; ++t < nofTriggers; )
+  {
+    if (triggers[t].epollFd == fd) break;
+  }
+
+  if (t == nofTriggers) return False;
+
+  ++pressureStatistics.events;
+  l = (pressureLevel) (pl_some + t);
+
+  if (l < level) return False;
+  armTimer (tm_pressure, monotonicNow () + PSI_EASE);
+  if (l == level) return False;
+
+  changeLevel (l);
+  return True;
+}
+
+static void
+unwatchPressure (void)
+{
+  int t; /* loop counter */
+
+  for (t = -1; ++t < nofTriggers; )
+  {
+    if (triggers[t].epollFd >= 0)
+    {
+      removeWatch (triggers[t].epollFd);
+      (void) close (triggers[t].epollFd);
+    }
+
+    if (triggers[t].psiFd >= 0) (void) close (triggers[t].psiFd);
+    triggers[t].epollFd = triggers[t].psiFd = -1;
+  }
+}
+#endif /* __linux__ */
+
+/*
+ *  Function for setting things up. Does nothing unless the kill
+ *  time is allowed to vary at all.
+ */
+void
+watchPressure (void)
+{
+#ifdef __linux__
+  struct epoll_event event;    /* as it says   */
+  char               spec[64]; /* the trigger  */
+  int                t;        /* loop counter */
+
+  if (minKillTime == maxKillTime) return;
+
+  levelSince = monotonicNow ();
+
+  for (t = -1; ++t < nofTriggers; )
+  {
+    (void) sprintf (spec, "%s %d %d", triggers[t].kind, triggers[t].stall,
+                    PSI_WINDOW);
+    (void) memset (&event, 0, sizeof (event));
+    event.events = EPOLLPRI;
+
+    if (   (triggers[t].psiFd = open ("/proc/pressure/memory",
+                                      O_RDWR | O_NONBLOCK | O_CLOEXEC)) < 0
+        || write (triggers[t].psiFd, spec, strlen (spec) + 1) < 0
+        || (triggers[t].epollFd = epoll_create1 (EPOLL_CLOEXEC)) < 0
+        || epoll_ctl (triggers[t].epollFd, EPOLL_CTL_ADD,
+                      triggers[t].psiFd, &event)
+        || !addWatch (triggers[t].epollFd, pressureChanged))
+    {
+      error1 ("Can't watch memory pressure (%s), using a fixed kill "
+              "time.\n", strerror (errno));
+      unwatchPressure ();
+      return;
+    }
+  }
+
+  watching = True;
+  trace (tr_pressure, level, killDelay ());
+#endif /* __linux__ */
+}
+
+/*
+ *  Called when the pressure timer expires, which means that nothing
+ *  has triggered at the current level or above for a while.
+ */
+void
+easePressure (void)
+{
+  disarmTimer (tm_pressure);
+  if (level == pl_none) return;
+
+#ifdef __linux__
+  changeLevel ((pressureLevel) (level - 1));
+#endif /* __linux__ */
+
+  if (level != pl_none)
+  {
+    armTimer (tm_pressure, monotonicNow () + PSI_EASE);
+  }
+}
+
+pressureLevel
+pressure (void)
+{
+  return level;
+}
+
+/*
+ *  Function for finding out how long to wait before killing, which
+ *  is what -killtime says unless we're watching the pressure.
+ */
+time_t
+killDelay (void)
+{
+  if (!watching) return killTime;
+
+  switch (level)
+  {
+    case pl_none: return maxKillTime;
+    case pl_some: return killTime;
+    default:      return minKillTime;
+  }
+}
+
+/*
+ *  Function for telling the user about the pressure.
+ */
+void
+reportPressureStats (void)
+{
+  pressureStats* stats = &pressureStatistics; /* as it says    */
+  msecs          spent[pl_count];             /* per level     */
+  int            l;                           /* loop counter  */
+
+  if (!watching) return;
+
+  for (l = -1; ++l < pl_count; ) spent[l] = stats->atLevel[l];
+  spent[level] += monotonicNow () - levelSince;
+
+  (void) fprintf (stderr,
+                  "pressure  : %lu events, %lu level changes, %lld s "
+                  "without, %lld s some, %lld s full.\n",
+                  stats->events, stats->changes, spent[pl_none] / 1000,
+                  spent[pl_some] / 1000, spent[pl_full] / 1000);
+}
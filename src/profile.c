@@ -0,0 +1,221 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          the stuff used to profile the phases of the main loop.
+ *
+ *          For every phase we keep track of the number of calls, the
+ *          wall clock and CPU time spent, and the number of X requests
+ *          and round trips. The requests are counted by means of the
+ *          request sequence numbers, the round trips by means of the
+ *          counters kept for -metrics, so neither costs any X traffic.
+ *          Every PROFILE_INTERVAL seconds, and on exit, a summary gets
+ *          appended to the -profile file.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "profile.h"
+#include "options.h"
+#include "metrics.h"
+#include "timer.h"
+#include "miscutil.h"
+
+Bool profiling = False; /* as it says */
+
+#ifndef VMS
+typedef struct
+{
+  unsigned long calls;      /* as it says                 */
+  long long     wallUsec;   /* CLOCK_MONOTONIC time spent */
+  long long     cpuUsec;    /* CPU time spent             */
+  unsigned long requests;   /* X requests issued          */
+  unsigned long roundTrips; /* ... that had to wait       */
+} phaseStats;
+
+static const char* phaseNames[pp_count] =
+  { "idle", "diy", "pointer", "triggers", "messages" };
+
+static phaseStats      interval[pp_count]; /* since the last summary      */
+static phaseStats      total[pp_count];    /* since we started            */
+static FILE*           out = 0;            /* the -profile file           */
+static struct timespec lastWall;           /* as of the previous mark     */
+static struct timespec lastCpu;            /* same                        */
+static unsigned long   lastRequest;        /* same                        */
+static unsigned long   lastRoundTrips;     /* same                        */
+static msecs           intervalStart;      /* as it says                  */
+static msecs           started;            /* as it says                  */
+
+/*
+ *  Function for reading a clock and returning how many microseconds
+ *  went by since the previous reading.
+ */
+static long long
+usecSince (clockid_t clock, struct timespec* last)
+{
+  struct timespec now;   /* as it says */
+  long long       usec;  /* as it says */
+
+  (void) clock_gettime (clock, &now);
+  usec =   (now.tv_sec - last->tv_sec) * 1000000LL
+         + (now.tv_nsec - last->tv_nsec) / 1000;
+  *last = now;
+
+  return usec;
+}
+
+static unsigned long
+roundTrips (void)
+{
+  unsigned long sum = 0;
+  int           s;
+
+  for (s = -1; ++s < xs_count; ) sum += metrics.xRoundTrips[s];
+
+  return sum;
+}
+
+/*
+ *  Function for writing a summary. Every line reads
+ *
+ *    kind stamp seconds phase calls wall_us cpu_us requests round_trips
+ *
+ *  where kind is either "interval" or "total", stamp is the time of
+ *  writing and seconds the length of the period covered.
+ */
+static void
+writeSummary (const char* kind, phaseStats* stats, double seconds)
+{
+  time_t now = time ((time_t*) 0);
+  int    p;
+
+  for (p = -1; ++p < pp_count; )
+  {
+    (void) fprintf (out, "%s %ld %.3f %s %lu %lld %lld %lu %lu\n",
+                    kind, (long) now, seconds, phaseNames[p],
+                    stats[p].calls, stats[p].wallUsec, stats[p].cpuUsec,
+                    stats[p].requests, stats[p].roundTrips);
+  }
+
+  (void) fflush (out);
+}
+
+static void
+endInterval (msecs now)
+{
+  int p;
+
+  writeSummary ("interval", interval, (now - intervalStart) / 1000.0);
+
+  for (p = -1; ++p < pp_count; )
+  {
+    total[p].calls += interval[p].calls;
+    total[p].wallUsec += interval[p].wallUsec;
+    total[p].cpuUsec += interval[p].cpuUsec;
+    total[p].requests += interval[p].requests;
+    total[p].roundTrips += interval[p].roundTrips;
+  }
+
+  (void) memset (interval, 0, sizeof (interval));
+  intervalStart = now;
+}
+#endif /* VMS */
+
+/*
+ *  Function for opening the -profile file, if any.
+ */
+void
+initProfile (void)
+{
+#ifndef VMS
+  if (!*profilePath) return;
+
+  if (!(out = fopen (profilePath, "a"))) /* = intended */
+  {
+    error1 ("Can't write profile to %s.\n", profilePath);
+    return;
+  }
+
+  (void) fcntl (fileno (out), F_SETFD, FD_CLOEXEC);
+  (void) fprintf (out, "# kind stamp seconds phase calls wall_us cpu_us "
+                       "requests round_trips\n");
+
+  started = intervalStart = monotonicNow ();
+  profiling = True;
+#endif /* VMS */
+}
+
+/*
+ *  Function for starting the clocks for the first phase.
+ */
+void
+markProfile (Display* d)
+{
+#ifndef VMS
+  (void) usecSince (CLOCK_MONOTONIC, &lastWall);
+  (void) usecSince (CLOCK_THREAD_CPUTIME_ID, &lastCpu);
+  lastRequest = NextRequest (d);
+  lastRoundTrips = roundTrips ();
+#endif /* VMS */
+}
+
+/*
+ *  Function for charging everything since the previous mark to the
+ *  given phase. The summary gets written after the last phase.
+ */
+void
+chargePhase (Display* d, profilePhase phase)
+{
+#ifndef VMS
+  phaseStats*   stats = &interval[phase];
+  unsigned long request = NextRequest (d);
+  unsigned long trips = roundTrips ();
+  msecs         now;
+
+  ++stats->calls;
+  stats->wallUsec += usecSince (CLOCK_MONOTONIC, &lastWall);
+  stats->cpuUsec += usecSince (CLOCK_THREAD_CPUTIME_ID, &lastCpu);
+  stats->requests += request - lastRequest;
+  stats->roundTrips += trips - lastRoundTrips;
+  lastRequest = request;
+  lastRoundTrips = trips;
+
+  if (   phase == pp_messages
+      && (now = monotonicNow ()) - intervalStart >= PROFILE_INTERVAL * 1000)
+  {
+    endInterval (now);
+  }
+#endif /* VMS */
+}
+
+/*
+ *  Function for writing the final summaries.
+ */
+void
+cleanupProfile (void)
+{
+#ifndef VMS
+  msecs now;
+
+  if (!profiling) return;
+
+  now = monotonicNow ();
+
+  endInterval (now);
+  writeSummary ("total", total, (now - started) / 1000.0);
+  (void) fclose (out);
+  out = 0;
+  profiling = False;
+#endif /* VMS */
+}
@@ -0,0 +1,1466 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          the stuff used to act on the processes of a locked session.
+ *
+ *          The session is either a cgroup (-cgroup) or, by default, all
+ *          processes sharing our session id, except for ourselves and
+ *          our own children (the locker and the hooks). Freezing uses
+ *          the cgroup v2 freezer in the former case and SIGSTOP in the
+ *          latter. Processes that were already stopped are left alone,
+ *          so that thawing doesn't continue somebody's ^Z'ed job. So are
+ *          the X server and the processes we descend from (xinit and
+ *          the like): stopping the former would leave us hanging on our
+ *          next round trip, with nobody left to thaw anything. The X
+ *          server is whoever the kernel says is at the other end of our
+ *          connection. Stopped processes are held on to by means of a
+ *          pidfd, so that the SIGCONT can't hit a newcomer that got the
+ *          pid of one that went away meanwhile.
+ *
+ *          Whether a freeze or thaw took effect is found out while the
+ *          main loop goes on: the cgroup lets us know through a watch on
+ *          cgroup.events, stopped processes have their state looked at
+ *          again every SESSION_RECHECK milliseconds.
+ *
+ *          Demoting the session while it's locked uses the cgroup's
+ *          cpu.weight and io.weight if there is one, and the nice value
+ *          and I/O priority of every thread otherwise, again except for
+ *          the X server and our ancestors. Either way, the old values
+ *          are kept and put back as they were on unlock.
+ *
+ *          Reclaiming memory of a session that has been locked for a
+ *          while goes by means of process_madvise (MADV_PAGEOUT) on the
+ *          anonymous mappings of its processes, other than the X server
+ *          and our ancestors, a bounded batch at a time, so as not to
+ *          hold up the main loop.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "session.h"
+#include "options.h"
+#include "watch.h"
+#include "trace.h"
+#include "miscutil.h"
+
+#ifdef __linux__
+#include <limits.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#endif /* __linux__ */
+
+#define CAP_SYS_NICE_BIT 23 /* as in linux/capability.h */
+
+#ifndef MADV_PAGEOUT
+#define MADV_PAGEOUT 21 /* as in linux/mman.h */
+#endif /* MADV_PAGEOUT */
+
+sessionStats sessionStatistics; /* as it says */
+
+#ifdef __linux__
+typedef struct
+{
+  pid_t              pid;      /* as it says                      */
+  char               state;    /* as in /proc/<pid>/stat          */
+  pid_t              ppid;     /* as it says                      */
+  pid_t              sid;      /* as it says                      */
+  unsigned long long ticks;    /* user + system CPU time so far   */
+  unsigned long long started;  /* start time, in ticks after boot */
+} procInfo;
+
+typedef void (*procVisitor) (const procInfo* info);
+
+typedef struct
+{
+  pid_t              pid;     /* as it says                          */
+  unsigned long long started; /* as in procInfo, to tell it apart    */
+  int                fd;      /* pidfd, or -1                        */
+} heldProcess;
+
+#define MAX_ANCESTORS 32
+
+static pid_t              ancestors[MAX_ANCESTORS];
+                                              /* processes we descend
+                                                 from                     */
+static int                nofAncestors = 0;   /* number of the above      */
+static pid_t              serverPid = 0;      /* the X server, if known   */
+
+static Bool               frozen = False;     /* as it says               */
+static struct timespec    frozenAt;           /* when that happened       */
+static msecs              baseCpu;            /* session CPU time at lock */
+static struct timespec    baseTime;           /* when that was measured   */
+static unsigned long long cpuRate;            /* CPU msecs per second
+                                                 before freezing          */
+static heldProcess*       stopped = 0;        /* processes we SIGSTOPped  */
+static int                nofStopped = 0;     /* number of the above      */
+static int                maxStopped = 0;     /* room for that many       */
+static int                newlyStopped;       /* during the current pass  */
+static Bool               changing = False;   /* whether a freeze or thaw
+                                                 has yet to take effect   */
+static struct timespec    changeStart;        /* when it was started      */
+static msecs              changeDeadline;     /* when to stop waiting     */
+static msecs              thawPeriod;         /* time spent frozen        */
+static int                eventsFd = -1;      /* cgroup.events, or -1     */
+static int                eventsWatch = -1;   /* epoll instance watching
+                                                 it, or -1                */
+
+#define IOPRIO_WHO_PROCESS 1         /* as in linux/ioprio.h           */
+#define IOPRIO_CLASS_RT    1         /* the real-time class, same source */
+#define IOPRIO_IDLE        (3 << 13) /* the idle class, same source    */
+
+typedef struct
+{
+  pid_t tid;    /* as it says                       */
+  int   nice;   /* its nice value before demotion   */
+  int   ioprio; /* same for its I/O priority, or -1 */
+} demotedTask;
+
+static Bool               demoted = False;    /* as it says               */
+static Bool               sysNice;            /* whether we have
+                                                 CAP_SYS_NICE             */
+static int                minNice;            /* lowest nice value we may
+                                                 put back                 */
+static demotedTask*       demotedTasks = 0;   /* threads we demoted       */
+static int                nofDemoted = 0;     /* number of the above      */
+static int                maxDemoted = 0;     /* room for that many       */
+static unsigned long      demotedProcs;       /* processes affected       */
+static char               oldCpuWeight[64];   /* cgroup cpu.weight before
+                                                 demotion, "" if
+                                                 unchanged                */
+static char               oldIoWeight[512];   /* same for io.weight       */
+
+static Bool               locked = False;     /* as it says               */
+static Bool               reclaiming = False; /* as it says               */
+static heldProcess*       reclaimPids = 0;    /* processes to go over     */
+static int                nofReclaimPids = 0; /* number of the above      */
+static int                maxReclaimPids = 0; /* room for that many       */
+static int                reclaimNext;        /* the one being worked on,
+                                                 held while we are        */
+static unsigned long      reclaimFrom;        /* where to carry on in its
+                                                 address space            */
+static long               rssBefore;          /* its RssAnon in kB before */
+static unsigned long      reclaimPages;       /* pages reclaimed so far   */
+static struct timespec    reclaimStart;       /* as it says               */
+
+static unsigned long
+usecsSince (const struct timespec* start)
+{
+  struct timespec now; /* as it says */
+
+  (void) clock_gettime (CLOCK_MONOTONIC, &now);
+  return   (now.tv_sec - start->tv_sec) * 1000000
+         + (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+/*
+ *  Function for getting the name of a file in the session cgroup.
+ */
+static const char*
+cgroupFile (const char* name)
+{
+  static char path[PATH_MAX]; /* as it says */
+
+  (void) snprintf (path, sizeof (path), "%s/%s", cgroupDir, name);
+  return path;
+}
+
+static Bool
+readFile (const char* path, char* buf, size_t size)
+{
+  int     fd;  /* as it says */
+  ssize_t got; /* as it says */
+
+  if ((fd = open (path, O_RDONLY | O_CLOEXEC)) < 0) /* = intended */
+  {
+    return False;
+  }
+
+  got = read (fd, buf, size - 1);
+  (void) close (fd);
+
+  if (got <= 0) return False;
+  buf[got] = '\0';
+  return True;
+}
+
+static Bool
+writeFile (const char* path, const char* text)
+{
+  int  fd; /* as it says */
+  Bool ok; /* as it says */
+
+  if ((fd = open (path, O_WRONLY | O_CLOEXEC)) < 0) /* = intended */
+  {
+    return False;
+  }
+
+  ok = write (fd, text, strlen (text)) == (ssize_t) strlen (text);
+  (void) close (fd);
+
+  return ok;
+}
+
+/*
+ *  Function for reading the bits of /proc/<pid>/stat we're after. The
+ *  command name is skipped by looking for the last parenthesis, as it
+ *  may contain anything, including blanks and parentheses.
+ */
+static Bool
+readProc (pid_t pid, procInfo* info)
+{
+  char               path[32];  /* as it says   */
+  char               buf[1024]; /* as it says   */
+  char*              rest;      /* after comm   */
+  int                fd;        /* as it says   */
+  ssize_t            got;       /* as it says   */
+  unsigned long long utime;     /* as it says   */
+  unsigned long long stime;     /* as it says   */
+
+  (void) sprintf (path, "/proc/%ld/stat", (long) pid);
+  if ((fd = open (path, O_RDONLY | O_CLOEXEC)) < 0) /* = intended */
+  {
+    return False;
+  }
+
+  got = read (fd, buf, sizeof (buf) - 1);
+  (void) close (fd);
+
+  if (got <= 0) return False;
+  buf[got] = '\0';
+
+  if (   !(rest = strrchr (buf, ')')) /* = intended */
+      || sscanf (rest + 2, "%c %d %*d %d %*d %*d %*u %*u %*u %*u %*u "
+                           "%llu %llu %*d %*d %*d %*d %*d %*d %llu",
+                 &info->state, &info->ppid, &info->sid, &utime, &stime,
+                 &info->started) != 6)
+  {
+    return False;
+  }
+
+  info->pid = pid;
+  info->ticks = utime + stime;
+  return True;
+}
+
+/*
+ *  Function for finding out which processes we descend from. They may
+ *  come and go, so this gets done before every walk.
+ */
+static void
+findAncestors (void)
+{
+  procInfo info;             /* as it says */
+  pid_t    pid = getppid (); /* same       */
+
+  nofAncestors = 0;
+
+  while (   pid > 1
+         && nofAncestors < MAX_ANCESTORS
+         && readProc (pid, &info))
+  {
+    ancestors[nofAncestors++] = pid;
+    pid = info.ppid;
+  }
+}
+
+/*
+ *  Function for telling whether a process is one we'd better leave
+ *  alone: one we descend from, or the X server.
+ */
+static Bool
+protectedProcess (const procInfo* info)
+{
+  int a; /* loop counter */
+
+  for (a = -1; ++a < nofAncestors; )
+  {
+    if (ancestors[a] == info->pid) return True;
+  }
+
+  return info->pid == serverPid;
+}
+
+/*
+ *  Functions for getting hold of a process by means of a pidfd, making
+ *  sure that it is still the one we read about, and not some newcomer
+ *  that got its pid. Where there are no pidfds, the start time gets
+ *  checked again before every signal instead.
+ */
+static Bool
+holdProcess (heldProcess* p)
+{
+#ifdef SYS_pidfd_open
+  procInfo info; /* as it says */
+
+  if ((p->fd = syscall (SYS_pidfd_open, p->pid, 0)) < 0) /* = intended */
+  {
+    return False;
+  }
+
+  if (!readProc (p->pid, &info) || info.started != p->started)
+  {
+    (void) close (p->fd);
+    p->fd = -1;
+    return False;
+  }
+
+  (void) fcntl (p->fd, F_SETFD, FD_CLOEXEC);
+#else /* SYS_pidfd_open */
+  p->fd = -1;
+#endif /* SYS_pidfd_open */
+
+  return True;
+}
+
+static Bool
+signalProcess (const heldProcess* p, int sig)
+{
+#ifdef HasPidfd
+  return !syscall (SYS_pidfd_send_signal, p->fd, sig, 0, 0);
+#else /* HasPidfd */
+  procInfo info; /* as it says */
+
+  return    readProc (p->pid, &info)
+         && info.started == p->started
+         && !kill (p->pid, sig);
+#endif /* HasPidfd */
+}
+
+static void
+releaseProcess (heldProcess* p)
+{
+  if (p->fd >= 0) (void) close (p->fd);
+  p->fd = -1;
+}
+
+/*
+ *  Function for visiting all processes of the session, other than
+ *  ourselves and our own children.
+ */
+static void
+forEachProcess (procVisitor visit)
+{
+  pid_t          self = getpid ();   /* as it says */
+  procInfo       info;               /* as it says */
+  FILE*          procs;              /* as it says */
+  DIR*           dir;                /* as it says */
+  struct dirent* entry;              /* as it says */
+  long           pid;                /* as it says */
+  char           c;                  /* dummy      */
+
+  findAncestors ();
+
+  if (*cgroupDir)
+  {
+    if (!(procs = fopen (cgroupFile ("cgroup.procs"), "r"))) /* = intended */
+    {
+      return;
+    }
+
+    while (fscanf (procs, "%ld", &pid) == 1)
+    {
+      if (   pid != self
+          && readProc ((pid_t) pid, &info)
+          && info.ppid != self)
+      {
+        visit (&info);
+      }
+    }
+
+    (void) fclose (procs);
+  }
+  else
+  {
+    if (!(dir = opendir ("/proc"))) return; /* = intended */
+
+    while ((entry = readdir (dir))) /* = intended */
+    {
+      if (   sscanf (entry->d_name, "%ld%c", &pid, &c) == 1
+          && pid != self
+          && readProc ((pid_t) pid, &info)
+          && info.sid == getsid (0)
+          && info.ppid != self)
+      {
+        visit (&info);
+      }
+    }
+
+    (void) closedir (dir);
+  }
+}
+
+/*
+ *  CPU time used by the session so far, in milliseconds. A cgroup keeps
+ *  count of it by itself, including what's been used by processes that
+ *  have already gone. Otherwise, we add up what the current processes
+ *  have used.
+ */
+static unsigned long long sumTicks; /* as it says */
+
+static void
+addTicks (const procInfo* info)
+{
+  sumTicks += info->ticks;
+}
+
+static msecs
+sessionCpu (void)
+{
+  FILE*              stat;  /* as it says */
+  unsigned long long usec;  /* as it says */
+
+  if (   *cgroupDir
+      && (stat = fopen (cgroupFile ("cpu.stat"), "r"))) /* = intended */
+  {
+    usec = 0;
+    (void) fscanf (stat, "usage_usec %llu", &usec);
+    (void) fclose (stat);
+    return (msecs) (usec / 1000);
+  }
+
+  sumTicks = 0;
+  forEachProcess (addTicks);
+  return (msecs) (sumTicks * 1000 / sysconf (_SC_CLK_TCK));
+}
+
+/*
+ *  Cgroup freezer support. The kernel lets us know about changes to
+ *  cgroup.events by means of POLLPRI.
+ */
+static Bool
+cgroupState (int fd, char wanted)
+{
+  char    buf[256];   /* as it says */
+  char*   frozenLine; /* as it says */
+  ssize_t got;        /* as it says */
+
+  if (   lseek (fd, 0, SEEK_SET)
+      || (got = read (fd, buf, sizeof (buf) - 1)) <= 0) /* = intended */
+  {
+    return False;
+  }
+
+  buf[got] = '\0';
+  return    (frozenLine = strstr (buf, "frozen ")) /* = intended */
+         && frozenLine[7] == wanted;
+}
+
+static void
+unwatchEvents (void)
+{
+  if (eventsWatch >= 0)
+  {
+    removeWatch (eventsWatch);
+    (void) close (eventsWatch);
+  }
+
+  if (eventsFd >= 0) (void) close (eventsFd);
+  eventsWatch = eventsFd = -1;
+}
+
+static void checkChange (void);
+
+/*
+ *  Watch handler. Reading from the epoll instance merely clears it,
+ *  cgroup.events itself gets read by checkChange ().
+ */
+static Bool
+cgroupChanged (Display* d, int fd)
+{
+  struct epoll_event event; /* as it says */
+
+  (void) epoll_wait (fd, &event, 1, 0);
+  checkChange ();
+  return False;
+}
+
+/*
+ *  Function for telling the cgroup to freeze or thaw. Whether it did
+ *  is left to checkChange (). Without a watch on cgroup.events, that
+ *  will have to look every SESSION_RECHECK milliseconds.
+ */
+static Bool
+freezeCgroup (Bool on)
+{
+  struct epoll_event event; /* as it says */
+
+  if (   (eventsFd = open (cgroupFile ("cgroup.events"), /* = intended */
+                           O_RDONLY | O_CLOEXEC)) < 0
+      || !writeFile (cgroupFile ("cgroup.freeze"), on ? "1" : "0"))
+  {
+    unwatchEvents ();
+    return False;
+  }
+
+  (void) memset (&event, 0, sizeof (event));
+  event.events = EPOLLPRI;
+
+  if (   (eventsWatch = epoll_create1 (EPOLL_CLOEXEC)) >= 0 /* = intended */
+      && (   epoll_ctl (eventsWatch, EPOLL_CTL_ADD, eventsFd, &event)
+          || !addWatch (eventsWatch, cgroupChanged)))
+  {
+    (void) close (eventsWatch);
+    eventsWatch = -1;
+  }
+
+  return True;
+}
+
+/*
+ *  SIGSTOP support. New processes may get forked while we're at it, so
+ *  we keep going over the lot until nothing is left to stop.
+ */
+static void
+stopOne (const procInfo* info)
+{
+  heldProcess* p; /* as it says */
+
+  if (strchr ("TtZX", info->state) || protectedProcess (info)) return;
+
+  if (nofStopped == maxStopped)
+  {
+    heldProcess* more;
+
+    more = newArray (heldProcess, maxStopped = maxStopped * 2 + 64);
+
+    if (nofStopped)
+    {
+      (void) memcpy (more, stopped, nofStopped * sizeof (heldProcess));
+    }
+
+    free (stopped);
+    stopped = more;
+  }
+
+  p = &stopped[nofStopped];
+  p->pid = info->pid;
+  p->started = info->started;
+
+  if (!holdProcess (p)) return;
+
+  if (signalProcess (p, SIGSTOP))
+  {
+    ++nofStopped;
+    ++newlyStopped;
+  }
+  else
+  {
+    releaseProcess (p);
+  }
+}
+
+static Bool
+signalledAll (Bool stop)
+{
+  procInfo info; /* as it says   */
+  int      p;    /* loop counter */
+
+  for (p = -1; ++p < nofStopped; )
+  {
+    if (   readProc (stopped[p].pid, &info)
+        && info.started == stopped[p].started
+        && (info.state == 'T') != stop)
+    {
+      return False;
+    }
+  }
+
+  return True;
+}
+
+static Bool
+stopProcesses (void)
+{
+  int pass; /* loop counter */
+
+  for (pass = -1; ++pass < 3; )
+  {
+    newlyStopped = 0;
+    forEachProcess (stopOne);
+    if (!newlyStopped) break;
+  }
+
+  return True;
+}
+
+static Bool
+continueProcesses (void)
+{
+  int p; /* loop counter */
+
+  for (p = -1; ++p < nofStopped; ) (void) signalProcess (&stopped[p], SIGCONT);
+  return True;
+}
+
+/*
+ *  Functions for keeping track of a freeze or thaw until it either
+ *  takes effect or SESSION_TIMEOUT runs out, in which case it counts
+ *  as unconfirmed. The session is taken to be frozen or not from the
+ *  moment we set out to do so.
+ */
+static void
+startChange (void)
+{
+  changing = True;
+  (void) clock_gettime (CLOCK_MONOTONIC, &changeStart);
+  changeDeadline = monotonicNow () + SESSION_TIMEOUT;
+}
+
+static Bool
+changeDone (void)
+{
+  if (*cgroupDir)
+  {
+    return eventsFd >= 0 && cgroupState (eventsFd, frozen ? '1' : '0');
+  }
+
+  return signalledAll (frozen);
+}
+
+static void
+finishChange (Bool ok)
+{
+  unsigned long usec = usecsSince (&changeStart); /* as it says   */
+  int           p;                                /* loop counter */
+
+  changing = False;
+  disarmTimer (tm_session);
+  unwatchEvents ();
+  if (!ok) ++sessionStatistics.unconfirmed;
+
+  if (frozen)
+  {
+    ++sessionStatistics.freezes;
+    sessionStatistics.freezeUsec += usec;
+    if (usec > sessionStatistics.maxFreezeUsec)
+    {
+      sessionStatistics.maxFreezeUsec = usec;
+    }
+
+    trace (tr_freeze, *cgroupDir ? -1 : nofStopped,
+           ok ? (long long) usec : -1);
+  }
+  else
+  {
+    for (p = -1; ++p < nofStopped; ) releaseProcess (&stopped[p]);
+    nofStopped = 0;
+
+    sessionStatistics.thawUsec += usec;
+    if (usec > sessionStatistics.maxThawUsec)
+    {
+      sessionStatistics.maxThawUsec = usec;
+    }
+
+    trace (tr_thaw, thawPeriod, ok ? (long long) usec : -1);
+  }
+}
+
+static void
+checkChange (void)
+{
+  msecs now = monotonicNow (); /* as it says */
+
+  if (!changing) return;
+
+  if (changeDone ())
+  {
+    finishChange (True);
+  }
+  else if (now >= changeDeadline)
+  {
+    finishChange (False);
+  }
+  else if (eventsWatch >= 0)
+  {
+    armTimer (tm_session, changeDeadline);
+  }
+  else
+  {
+    armTimer (tm_session, MIN (changeDeadline, now + SESSION_RECHECK));
+  }
+}
+
+/*
+ *  Demotion support, per thread since that's what nice values and I/O
+ *  priorities apply to under Linux. Notice that an unprivileged user
+ *  can't renice anything back up unless RLIMIT_NICE allows it, nor put
+ *  back a real-time I/O class, so those are left as they are. The
+ *  cgroup is the better way if there is one.
+ */
+static int
+lowestNice (Bool privileged)
+{
+  struct rlimit limit; /* as it says */
+
+  if (privileged) return -20;
+  if (getrlimit (RLIMIT_NICE, &limit)) return 20;
+
+  return limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur >= 40
+         ? -20 : 20 - (int) limit.rlim_cur;
+}
+
+static void
+demoteTask (pid_t tid)
+{
+  demotedTask* t;    /* as it says */
+  int          nice; /* as it says */
+
+  errno = 0;
+  nice = getpriority (PRIO_PROCESS, tid);
+  if (errno) return;
+
+  if (nofDemoted == maxDemoted)
+  {
+    demotedTask* more;
+
+    more = newArray (demotedTask, maxDemoted = maxDemoted * 2 + 64);
+
+    if (nofDemoted)
+    {
+      (void) memcpy (more, demotedTasks, nofDemoted * sizeof (demotedTask));
+    }
+
+    free (demotedTasks);
+    demotedTasks = more;
+  }
+
+  t = &demotedTasks[nofDemoted++];
+  t->tid = tid;
+  t->nice = nice;
+  t->ioprio = -1;
+
+ /*
+  *  A nice value we couldn't put back is left alone, as is a
+  *  real-time I/O class further down.
+  */
+  if (nice < minNice) t->nice = DEMOTE_NICE;
+
+#ifdef SYS_ioprio_get
+  if (   (t->ioprio = syscall (SYS_ioprio_get, IOPRIO_WHO_PROCESS, tid)) >= 0
+      && t->ioprio >> 13 == IOPRIO_CLASS_RT
+      && !sysNice)
+  {
+    t->ioprio = -1;
+  }
+
+  if (t->ioprio >= 0)
+  {
+    (void) syscall (SYS_ioprio_set, IOPRIO_WHO_PROCESS, tid, IOPRIO_IDLE);
+  }
+#endif /* SYS_ioprio_get */
+
+  if (t->nice < DEMOTE_NICE)
+  {
+    (void) setpriority (PRIO_PROCESS, tid, DEMOTE_NICE);
+  }
+}
+
+static void
+demoteProcess (const procInfo* info)
+{
+  char           path[32]; /* as it says */
+  DIR*           dir;      /* as it says */
+  struct dirent* entry;    /* as it says */
+  long           tid;      /* as it says */
+  char           c;        /* dummy      */
+
+  if (protectedProcess (info)) return;
+
+  (void) sprintf (path, "/proc/%ld/task", (long) info->pid);
+  if (!(dir = opendir (path))) return; /* = intended */
+
+  while ((entry = readdir (dir))) /* = intended */
+  {
+    if (sscanf (entry->d_name, "%ld%c", &tid, &c) == 1)
+    {
+      demoteTask ((pid_t) tid);
+    }
+  }
+
+  (void) closedir (dir);
+  ++demotedProcs;
+}
+
+static Bool
+restoreTasks (void)
+{
+  demotedTask* t;         /* as it says   */
+  int          i;         /* loop counter */
+  Bool         ok = True; /* as it says   */
+
+  for (i = -1; ++i < nofDemoted; )
+  {
+    t = &demotedTasks[i];
+
+    if (   (   t->nice < DEMOTE_NICE
+            && setpriority (PRIO_PROCESS, t->tid, t->nice)
+            && errno != ESRCH)
+#ifdef SYS_ioprio_set
+        || (   t->ioprio >= 0
+            && syscall (SYS_ioprio_set, IOPRIO_WHO_PROCESS, t->tid, t->ioprio)
+            && errno != ESRCH)
+#endif /* SYS_ioprio_set */
+       )
+    {
+      ++sessionStatistics.restoreFailures;
+      ok = False;
+    }
+  }
+
+  nofDemoted = 0;
+  return ok;
+}
+
+static void
+countProcess (const procInfo* info)
+{
+  ++demotedProcs;
+}
+
+/*
+ *  Cgroup weight support. The old contents get written back line by
+ *  line, as io.weight may have per device lines besides the default.
+ */
+static void
+turnDown (const char* name, char* old, size_t size, const char* value)
+{
+  if (   !readFile (cgroupFile (name), old, size)
+      || !writeFile (cgroupFile (name), value))
+  {
+    *old = '\0';
+  }
+}
+
+static Bool
+turnBackUp (const char* name, char* old)
+{
+  char* line;      /* as it says */
+  char* next;      /* as it says */
+  Bool  ok = True; /* as it says */
+
+  for (line = old; *line; line = next)
+  {
+    next = line + strcspn (line, "\n");
+    if (*next) *next++ = '\0';
+
+    if (*line && !writeFile (cgroupFile (name), line))
+    {
+      ++sessionStatistics.restoreFailures;
+      ok = False;
+    }
+  }
+
+  *old = '\0';
+  return ok;
+}
+
+static void
+demoteSession (void)
+{
+  struct timespec start;      /* as it says */
+  unsigned long   usec;       /* as it says */
+  char            weight[32]; /* as it says */
+
+  (void) clock_gettime (CLOCK_MONOTONIC, &start);
+  demotedProcs = 0;
+
+  if (*cgroupDir)
+  {
+    (void) sprintf (weight, "%d", DEMOTE_WEIGHT);
+    turnDown ("cpu.weight", oldCpuWeight, sizeof (oldCpuWeight), weight);
+    (void) sprintf (weight, "default %d", DEMOTE_WEIGHT);
+    turnDown ("io.weight", oldIoWeight, sizeof (oldIoWeight), weight);
+    forEachProcess (countProcess);
+  }
+  else
+  {
+    minNice = lowestNice (sysNice = hasSysNice ());
+    forEachProcess (demoteProcess);
+  }
+
+  usec = usecsSince (&start);
+  demoted = True;
+  ++sessionStatistics.demotions;
+  sessionStatistics.demotedProcs += demotedProcs;
+  sessionStatistics.demoteUsec += usec;
+
+  trace (tr_demote, demotedProcs, usec);
+}
+
+static void
+restoreSession (void)
+{
+  struct timespec start; /* as it says */
+  unsigned long   usec;  /* as it says */
+  Bool            ok;    /* as it says */
+
+  (void) clock_gettime (CLOCK_MONOTONIC, &start);
+
+  if (*cgroupDir)
+  {
+    ok = turnBackUp ("cpu.weight", oldCpuWeight);
+    ok = turnBackUp ("io.weight", oldIoWeight) && ok;
+  }
+  else
+  {
+    ok = restoreTasks ();
+  }
+
+  usec = usecsSince (&start);
+  demoted = False;
+  sessionStatistics.restoreUsec += usec;
+
+  trace (tr_restore, demotedProcs, ok ? (long long) usec : -1);
+}
+
+/*
+ *  Memory reclaim support. A process is done with when we get to the
+ *  end of its mappings, which may take several batches. What it gave
+ *  up is told by how much its RssAnon went down meanwhile.
+ */
+static void
+addReclaimPid (const procInfo* info)
+{
+  heldProcess* p; /* as it says */
+
+  if (protectedProcess (info)) return;
+
+  if (nofReclaimPids == maxReclaimPids)
+  {
+    heldProcess* more;
+
+    more = newArray (heldProcess, maxReclaimPids = maxReclaimPids * 2 + 64);
+
+    if (nofReclaimPids)
+    {
+      (void) memcpy (more, reclaimPids, nofReclaimPids * sizeof (heldProcess));
+    }
+
+    free (reclaimPids);
+    reclaimPids = more;
+  }
+
+  p = &reclaimPids[nofReclaimPids++];
+  p->pid = info->pid;
+  p->started = info->started;
+  p->fd = -1;
+}
+
+static long
+rssAnon (pid_t pid)
+{
+  char  path[32];  /* as it says */
+  char  line[256]; /* as it says */
+  FILE* status;    /* as it says */
+  long  kb = -1;   /* as it says */
+
+  (void) sprintf (path, "/proc/%ld/status", (long) pid);
+  if (!(status = fopen (path, "r"))) return -1; /* = intended */
+
+  while (kb < 0 && fgets (line, sizeof (line), status))
+  {
+    if (sscanf (line, "RssAnon: %ld", &kb) != 1) kb = -1;
+  }
+
+  (void) fclose (status);
+  return kb;
+}
+
+static void
+doneWithProcess (void)
+{
+  long after = rssAnon (reclaimPids[reclaimNext].pid); /* as it says */
+
+  if (after >= 0 && rssBefore > after)
+  {
+    reclaimPages += (rssBefore - after) * 1024 / sysconf (_SC_PAGESIZE);
+  }
+
+  releaseProcess (&reclaimPids[reclaimNext]);
+  ++reclaimNext;
+}
+
+/*
+ *  Function for paging out at most RECLAIM_BATCH megabytes in at most
+ *  RECLAIM_RANGES pieces. Returns True if there's more to do.
+ */
+static Bool
+reclaimBatch (void)
+{
+#ifdef HasReclaim
+  struct iovec  ranges[RECLAIM_RANGES];       /* as it says              */
+  int           n;                            /* number of ranges        */
+  unsigned long budget = RECLAIM_BATCH << 20; /* bytes left to do        */
+  unsigned long start;                        /* of a mapping            */
+  unsigned long end;                          /* same                    */
+  unsigned long inode;                        /* same                    */
+  unsigned long len;                          /* of a range              */
+  char          perms[8];                     /* of a mapping            */
+  char          path[32];                     /* as it says              */
+  char          line[PATH_MAX + 128];         /* as it says              */
+  char*         name;                         /* of a mapping            */
+  int           offset;                       /* of the name in the line */
+  FILE*         maps;                         /* as it says              */
+  Bool          more;                         /* lines left in maps      */
+  heldProcess*  p;                            /* as it says              */
+
+  while (budget && reclaimNext < nofReclaimPids)
+  {
+    p = &reclaimPids[reclaimNext];
+
+    if (p->fd < 0)
+    {
+      if (!holdProcess (p))
+      {
+        ++reclaimNext;
+        continue;
+      }
+
+      rssBefore = rssAnon (p->pid);
+      reclaimFrom = 0;
+    }
+
+    (void) sprintf (path, "/proc/%ld/maps", (long) p->pid);
+    if (!(maps = fopen (path, "r"))) /* = intended */
+    {
+      doneWithProcess ();
+      continue;
+    }
+
+   /*
+    *  Anonymous means no inode, and either no name at all or one of
+    *  the kernel's own like [heap] and [anon:...], but not [vdso] and
+    *  friends.
+    */
+    n = 0;
+
+    while ((more = fgets (line, sizeof (line), maps) != 0)) /* = intended */
+    {
+      offset = 0;
+
+      if (   sscanf (line, "%lx-%lx %7s %*s %*s %lu %n",
+                     &start, &end, perms, &inode, &offset) < 4
+          || end <= reclaimFrom
+          || inode
+          || (perms[0] != 'r' && perms[1] != 'w'))
+      {
+        continue;
+      }
+
+      name = line + offset;
+      if (   *name
+          && strncmp (name, "[heap]", 6)
+          && strncmp (name, "[stack]", 7)
+          && strncmp (name, "[anon:", 6))
+      {
+        continue;
+      }
+
+      start = MAX (start, reclaimFrom);
+      len = MIN (end - start, budget);
+      ranges[n].iov_base = (void*) start;
+      ranges[n].iov_len = len;
+      budget -= len;
+      reclaimFrom = start + len;
+
+      if (++n == RECLAIM_RANGES || !budget) break;
+    }
+
+    (void) fclose (maps);
+
+    if (   n
+        && syscall (SYS_process_madvise, p->fd, ranges, n,
+                    MADV_PAGEOUT, 0) < 0
+        && (errno == EPERM || errno == ESRCH || errno == ENOSYS))
+    {
+      if (errno != ESRCH) ++sessionStatistics.reclaimFailures;
+      more = False;
+    }
+
+    if (!more) doneWithProcess ();
+  }
+
+  return reclaimNext < nofReclaimPids;
+#else /* HasReclaim */
+  return False;
+#endif /* HasReclaim */
+}
+
+static void
+stopReclaim (Bool done)
+{
+  unsigned long usec = usecsSince (&reclaimStart); /* as it says */
+
+  if (reclaimNext < nofReclaimPids)
+  {
+    releaseProcess (&reclaimPids[reclaimNext]);
+  }
+
+  reclaiming = False;
+  disarmTimer (tm_reclaim);
+
+  if (done) ++sessionStatistics.reclaims;
+  else      ++sessionStatistics.reclaimsStopped;
+  sessionStatistics.reclaimedPages += reclaimPages;
+
+  trace (tr_reclaim, reclaimPages, done ? (long long) usec / 1000 : -1);
+}
+#endif /* __linux__ */
+
+/*
+ *  Function for telling whether we have CAP_SYS_NICE, which is what
+ *  it takes to raise nice values at will, and to act on the memory of
+ *  other processes.
+ */
+Bool
+hasSysNice (void)
+{
+#ifdef __linux__
+  char               line[256];     /* as it says */
+  FILE*              status;        /* as it says */
+  unsigned long long caps = 0;      /* effective  */
+
+  if (!(status = fopen ("/proc/self/status", "r"))) /* = intended */
+  {
+    return False;
+  }
+
+  while (fgets (line, sizeof (line), status))
+  {
+    if (sscanf (line, "CapEff: %llx", &caps) == 1) break;
+  }
+
+  (void) fclose (status);
+  return (caps >> CAP_SYS_NICE_BIT) & 1;
+#else /* __linux__ */
+  return False;
+#endif /* __linux__ */
+}
+
+/*
+ *  Function for telling whether a nice value, once raised, could be
+ *  put back.
+ */
+Bool
+canRestoreNice (int nice)
+{
+#ifdef __linux__
+  return nice >= lowestNice (hasSysNice ());
+#else /* __linux__ */
+  return False;
+#endif /* __linux__ */
+}
+
+/*
+ *  Function for finding out which process the X server is, by asking the
+ *  kernel who's at the other end of our connection. That only works for
+ *  local connections, but a server elsewhere is out of our reach anyway.
+ */
+void
+findServer (Display* d)
+{
+#if defined (__linux__) && defined (SO_PEERCRED)
+  struct
+  {
+    pid_t pid;
+    uid_t uid;
+    gid_t gid;
+  }         peer;                  /* as struct ucred, which glibc
+                                      only has for _GNU_SOURCE      */
+  socklen_t size = sizeof (peer);  /* as it says                    */
+
+  if (   !getsockopt (ConnectionNumber (d), SOL_SOCKET, SO_PEERCRED,
+                      &peer, &size)
+      && peer.pid > 0)
+  {
+    serverPid = peer.pid;
+  }
+#endif /* __linux__ && SO_PEERCRED */
+}
+
+/*
+ *  Function for telling whether a cgroup contains ourselves, which would
+ *  make freezing it a rather bad idea.
+ */
+Bool
+cgroupHoldsUs (const char* dir)
+{
+#ifdef __linux__
+  char   own[sizeof (CGROUP_ROOT) + PATH_MAX];
+                           /* our cgroup, as a path */
+  char   target[PATH_MAX]; /* as it says            */
+  char   line[PATH_MAX];   /* as it says            */
+  FILE*  cgroups;          /* as it says            */
+  size_t len;              /* as it says            */
+  Bool   found = False;    /* as it says            */
+
+  if (   !realpath (dir, target)
+      || !(cgroups = fopen ("/proc/self/cgroup", "r"))) /* = intended */
+  {
+    return False;
+  }
+
+  while (fgets (line, sizeof (line), cgroups))
+  {
+    if (!strncmp (line, "0::", 3))
+    {
+      line[strcspn (line, "\n")] = '\0';
+      (void) sprintf (own, "%s%s", CGROUP_ROOT, line + 3);
+      len = strlen (target);
+      found =    !strncmp (own, target, len)
+              && (own[len] == '/' || own[len] == '\0');
+    }
+  }
+
+  (void) fclose (cgroups);
+  return found;
+#else /* __linux__ */
+  return False;
+#endif /* __linux__ */
+}
+
+static void thawSession (void);
+
+/*
+ *  Things to do when the locker gets started. For the freezer, we take
+ *  note of how much CPU time the session has used so far. What it uses
+ *  from then on up to the moment it gets frozen tells how much it would
+ *  have used while frozen.
+ */
+void
+sessionLocked (void)
+{
+#ifdef __linux__
+  locked = True;
+  if (useDemotion && !demoted) demoteSession ();
+
+  if (reclaimTime)
+  {
+    armTimer (tm_reclaim, monotonicNow () + reclaimTime * 1000);
+  }
+
+  if (useFreezer && !frozen)
+  {
+    baseCpu = sessionCpu ();
+    (void) clock_gettime (CLOCK_MONOTONIC, &baseTime);
+  }
+#endif /* __linux__ */
+}
+
+/*
+ *  Things to do when the locker is gone, or we are.
+ */
+void
+sessionUnlocked (void)
+{
+  thawSession ();
+
+#ifdef __linux__
+  if (reclaiming) stopReclaim (False);
+  disarmTimer (tm_reclaim);
+  if (demoted) restoreSession ();
+  locked = False;
+#endif /* __linux__ */
+}
+
+/*
+ *  Called on any sign of life, so it had better be cheap if there is
+ *  nothing to do. Reclaiming starts all over again once the user has
+ *  been gone long enough.
+ */
+void
+sessionActivity (void)
+{
+  thawSession ();
+
+#ifdef __linux__
+  if (reclaiming) stopReclaim (False);
+
+  if (locked && reclaimTime)
+  {
+    armTimer (tm_reclaim, monotonicNow () + reclaimTime * 1000);
+  }
+#endif /* __linux__ */
+}
+
+/*
+ *  Called whenever the reclaim timer expires, to do the next batch.
+ */
+void
+reclaimSession (void)
+{
+#ifdef __linux__
+  struct timespec start; /* as it says */
+
+  if (!reclaiming)
+  {
+    (void) clock_gettime (CLOCK_MONOTONIC, &reclaimStart);
+    nofReclaimPids = 0;
+    forEachProcess (addReclaimPid);
+    reclaimNext = 0;
+    reclaimPages = 0;
+    reclaiming = True;
+  }
+
+  (void) clock_gettime (CLOCK_MONOTONIC, &start);
+
+  if (reclaimBatch ())
+  {
+    armTimer (tm_reclaim, monotonicNow () + RECLAIM_PAUSE);
+  }
+  else
+  {
+    stopReclaim (True);
+  }
+
+  sessionStatistics.reclaimUsec += usecsSince (&start);
+#endif /* __linux__ */
+}
+
+void
+freezeSession (void)
+{
+#ifdef __linux__
+  unsigned long elapsed; /* as it says */
+  msecs         used;    /* as it says */
+
+  if (!useFreezer || frozen) return;
+  if (changing) finishChange (changeDone ());
+
+ /*
+  *  Without a cgroup, processes that exit take their CPU time with
+  *  them, so the sum may well have gone down.
+  */
+  elapsed = baseTime.tv_sec ? usecsSince (&baseTime) / 1000 : 0;
+  used = elapsed ? sessionCpu () - baseCpu : 0;
+  cpuRate = used > 0 ? used * 1000 / elapsed : 0;
+
+  frozen = True;
+  startChange ();
+  frozenAt = changeStart;
+
+  if (*cgroupDir ? freezeCgroup (True) : stopProcesses ())
+  {
+    checkChange ();
+  }
+  else
+  {
+    finishChange (False);
+  }
+#endif /* __linux__ */
+}
+
+static void
+thawSession (void)
+{
+#ifdef __linux__
+  if (!frozen) return;
+  if (changing) finishChange (changeDone ());
+
+  thawPeriod = usecsSince (&frozenAt) / 1000;
+  frozen = False;
+  baseTime.tv_sec = 0;
+  sessionStatistics.frozenMsec += thawPeriod;
+  sessionStatistics.reclaimedMsec += thawPeriod * cpuRate / 1000;
+
+  startChange ();
+
+  if (*cgroupDir ? freezeCgroup (False) : continueProcesses ())
+  {
+    checkChange ();
+  }
+  else
+  {
+    finishChange (False);
+  }
+#endif /* __linux__ */
+}
+
+/*
+ *  Called whenever the session timer expires, to see whether a freeze
+ *  or thaw has taken effect by now.
+ */
+void
+checkSession (void)
+{
+  disarmTimer (tm_session);
+
+#ifdef __linux__
+  checkChange ();
+#endif /* __linux__ */
+}
+
+/*
+ *  Function for telling whether the user's return should be noticed
+ *  without delay.
+ */
+Bool
+sessionWatched (void)
+{
+#ifdef __linux__
+  return frozen || reclaiming;
+#else /* __linux__ */
+  return False;
+#endif /* __linux__ */
+}
+
+void
+reportSessionStats (void)
+{
+  sessionStats* stats = &sessionStatistics;
+
+  if (stats->freezes)
+  {
+    (void) fprintf (stderr,
+                    "session   : %lu freezes, %lu unconfirmed, "
+                    "%lu us average, %lu us worst to freeze, "
+                    "%lu us average, %lu us worst to thaw.\n",
+                    stats->freezes, stats->unconfirmed,
+                    stats->freezeUsec / stats->freezes, stats->maxFreezeUsec,
+                    stats->thawUsec / stats->freezes, stats->maxThawUsec);
+    (void) fprintf (stderr,
+                    "session   : %lld s frozen, %lld.%03lld s of CPU time "
+                    "reclaimed.\n", stats->frozenMsec / 1000,
+                    stats->reclaimedMsec / 1000, stats->reclaimedMsec % 1000);
+  }
+
+  if (stats->demotions)
+  {
+    (void) fprintf (stderr,
+                    "session   : %lu demotions of %lu processes on average, "
+                    "%lu us average to demote, %lu us average to restore, "
+                    "%lu failed to restore.\n",
+                    stats->demotions, stats->demotedProcs / stats->demotions,
+                    stats->demoteUsec / stats->demotions,
+                    stats->restoreUsec / stats->demotions,
+                    stats->restoreFailures);
+  }
+
+  if (stats->reclaims || stats->reclaimsStopped)
+  {
+    (void) fprintf (stderr,
+                    "session   : %lu memory reclaims done, %lu stopped, "
+                    "%lu pages reclaimed, %lu us spent, "
+                    "%lu processes refused.\n",
+                    stats->reclaims, stats->reclaimsStopped,
+                    stats->reclaimedPages, stats->reclaimUsec,
+                    stats->reclaimFailures);
+  }
+}
@@ -0,0 +1,312 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          the stuff used to spread locker starts across instances.
+ *
+ *          When everybody leaves at the same time, every instance on
+ *          the host would start its locker within the same few seconds.
+ *          To prevent that, all of them share a small file that keeps
+ *          count of the lockers started during each of the last few
+ *          seconds. An instance that finds more than STAGGER_LAUNCHES
+ *          of them in the last STAGGER_WINDOW seconds moves its lock
+ *          timer a random bit into the future, and tries again then.
+ *          The more crowded, the further, but never more than -stagger
+ *          seconds beyond the original deadline. Once there, the locker
+ *          gets started no matter what.
+ *
+ *          The counts are updated with compare-and-swap only, so there
+ *          is no lock for an instance to die holding. Each one carries
+ *          the second it belongs to, so stale ones get recognised and
+ *          started over by whoever comes along next.
+ *
+ *          Any local user can write to the file, so nothing in it is
+ *          trusted further than need be. Counts above STAGGER_SANE are
+ *          taken to be garbage and started over, and however crowded
+ *          the file says it is, the locker is never held back for more
+ *          than -stagger seconds. The file may also get truncated under
+ *          our feet, which makes touching the mapping raise SIGBUS. That
+ *          is caught, and staggering given up on.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "stagger.h"
+#include "options.h"
+#include "state.h"
+#include "lock.h"
+#include "trace.h"
+#include "miscutil.h"
+
+#include <errno.h>
+
+#ifdef HasStagger
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <setjmp.h>
+#endif /* HasStagger */
+
+staggerStats staggerStatistics; /* as it says */
+
+#ifdef HasStagger
+#define STAGGER_SLOTS 16 /* seconds kept track of, > STAGGER_WINDOW */
+
+typedef struct
+{
+  unsigned long long slots[STAGGER_SLOTS]; /* second << 32 | launches */
+} staggerPage;
+
+static staggerPage* page = 0;     /* the shared file, or 0         */
+static msecs        origDeadline; /* lock deadline before we moved
+                                     it, if we did                 */
+static msecs        movedTo = 0;  /* where we moved it to, if so   */
+static sigjmp_buf   truncated;    /* where to go on SIGBUS         */
+
+/*
+ *  The shared clock. CLOCK_MONOTONIC is the same for every process
+ *  on the host, unlike what monotonicNow() may have been told.
+ */
+static unsigned long long
+currentSecond (void)
+{
+  struct timespec now; /* as it says */
+
+  (void) clock_gettime (CLOCK_MONOTONIC, &now);
+  return (unsigned long long) now.tv_sec;
+}
+
+/*
+ *  Function for adding one to, or taking one from, the number of
+ *  lockers started during a given second. Returns the new number.
+ */
+static unsigned
+countLaunch (unsigned long long sec, int delta)
+{
+  unsigned long long* slot = &page->slots[sec % STAGGER_SLOTS];
+                                /* as it says */
+  unsigned long long  old;      /* same       */
+  unsigned long long  updated;  /* same       */
+
+  old = __atomic_load_n (slot, __ATOMIC_ACQUIRE);
+
+  do
+  {
+    if ((old >> 32) != sec || (old & 0xffffffff) > STAGGER_SANE)
+    {
+      if (delta < 0) return 0;
+      updated = sec << 32 | 1;
+    }
+    else if (delta < 0 && !(old & 0xffffffff))
+    {
+      return 0;
+    }
+    else
+    {
+      updated = old + delta;
+    }
+  }
+  while (!__atomic_compare_exchange_n (slot, &old, updated, False,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+  return (unsigned) (updated & 0xffffffff);
+}
+
+/*
+ *  Function for counting the lockers started during the seconds of
+ *  the window before the given one.
+ */
+static unsigned
+earlierLaunches (unsigned long long sec)
+{
+  unsigned long long slot;    /* as it says   */
+  unsigned           sum = 0; /* same         */
+  int                s;       /* loop counter */
+
+  for (s = 0; ++s < STAGGER_WINDOW; )
+  {
+    slot = __atomic_load_n (&page->slots[(sec - s) % STAGGER_SLOTS],
+                            __ATOMIC_ACQUIRE);
+    if (   (slot >> 32) == sec - s
+        && (slot & 0xffffffff) <= STAGGER_SANE)
+    {
+      sum += (unsigned) (slot & 0xffffffff);
+    }
+  }
+
+  return sum;
+}
+
+static void
+busError (int sig)
+{
+  siglongjmp (truncated, 1);
+}
+#endif /* HasStagger */
+
+/*
+ *  Function for setting things up. The file is created readable and
+ *  writable for everybody, as instances of all users need to share
+ *  it. Does nothing unless -stagger was given.
+ */
+void
+openStagger (void)
+{
+#ifdef HasStagger
+  struct stat info; /* as it says */
+  void*       map;  /* same       */
+  int         fd;   /* same       */
+
+  if (!staggerMax) return;
+
+  if ((fd = open (STAGGER_FILE, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC,
+                  0666)) < 0)
+  {
+    error2 ("Can't open %s (%s), not staggering.\n", STAGGER_FILE,
+            strerror (errno));
+    return;
+  }
+
+  if (!fstat (fd, &info) && !S_ISREG (info.st_mode))
+  {
+    error1 ("%s is not a regular file, not staggering.\n", STAGGER_FILE);
+    (void) close (fd);
+    return;
+  }
+
+  if (   fstat (fd, &info)
+      || (info.st_uid == geteuid () && fchmod (fd, 0666))
+      || (   (size_t) info.st_size < sizeof (staggerPage)
+          && ftruncate (fd, sizeof (staggerPage)))
+      || (map = mmap (0, sizeof (staggerPage), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0)) == MAP_FAILED)
+  {
+    error2 ("Can't use %s (%s), not staggering.\n", STAGGER_FILE,
+            strerror (errno));
+    (void) close (fd);
+    return;
+  }
+
+  (void) close (fd);
+  page = (staggerPage*) map;
+  srandom ((unsigned) getpid () ^ (unsigned) time ((time_t*) 0));
+#endif /* HasStagger */
+}
+
+/*
+ *  Function for deciding whether the locker may be started now. Only
+ *  the lock timer is held back, not -locknow nor a `+' corner. Returns
+ *  False after moving the lock timer to when to try again.
+ */
+Bool
+staggerLaunch (msecs now)
+{
+#ifdef HasStagger
+  unsigned long long sec;      /* as it says                    */
+  unsigned           launches; /* in the window, ours included  */
+  msecs              bound;    /* how long we may wait at most  */
+  msecs              delay;    /* how long we'll wait this time */
+  struct sigaction   action;   /* for catching SIGBUS           */
+  struct sigaction   previous; /* what to put back afterwards   */
+
+  if (   !page
+      || lockerPid
+      || screenLocked ()
+      || !timerArmed (tm_lock)
+      || lockDeadline () != timerDeadline (tm_lock))
+  {
+    return True;
+  }
+
+ /*
+  *  Anything else having moved the lock timer means that this is
+  *  a new attempt, rather than us trying again.
+  */
+  if (timerDeadline (tm_lock) != movedTo)
+  {
+    origDeadline = timerDeadline (tm_lock);
+    movedTo = 0;
+  }
+
+  (void) memset (&action, 0, sizeof (action));
+  action.sa_handler = busError;
+  (void) sigaction (SIGBUS, &action, &previous);
+
+  if (sigsetjmp (truncated, 1))
+  {
+    (void) sigaction (SIGBUS, &previous, 0);
+    (void) munmap (page, sizeof (staggerPage));
+    page = 0;
+    movedTo = 0;
+    return True;
+  }
+
+  sec = currentSecond ();
+  launches = countLaunch (sec, 1) + earlierLaunches (sec);
+  bound = origDeadline + staggerMax * 1000 - now;
+
+  if (launches <= STAGGER_LAUNCHES || bound <= 0)
+  {
+    (void) sigaction (SIGBUS, &previous, 0);
+
+    ++staggerStatistics.launches;
+
+    if (movedTo)
+    {
+      ++staggerStatistics.staggered;
+      if (launches > STAGGER_LAUNCHES) ++staggerStatistics.capped;
+      staggerStatistics.delayed += now - origDeadline;
+      staggerStatistics.maxDelayed = MAX (staggerStatistics.maxDelayed,
+                                          now - origDeadline);
+      movedTo = 0;
+    }
+
+    return True;
+  }
+
+  (void) countLaunch (sec, -1);
+  (void) sigaction (SIGBUS, &previous, 0);
+
+  bound = MIN (bound, (launches - STAGGER_LAUNCHES) * STAGGER_SPREAD);
+  delay = 1 + random () % bound;
+  armTimer (tm_lock, movedTo = now + delay);
+
+  ++staggerStatistics.deferrals;
+  trace (tr_stagger, launches, delay);
+  return False;
+#else /* HasStagger */
+  return True;
+#endif /* HasStagger */
+}
+
+/*
+ *  Function for telling the user about the staggering.
+ */
+void
+reportStaggerStats (void)
+{
+  staggerStats* stats = &staggerStatistics; /* as it says */
+
+  if (stats->deferrals)
+  {
+    (void) fprintf (stderr,
+                    "stagger   : %lu launches, %lu held back %lu times, "
+                    "%lu of them till the end, %lld ms average, %lld ms "
+                    "longest.\n",
+                    stats->launches, stats->staggered, stats->deferrals,
+                    stats->capped,
+                    stats->staggered ? stats->delayed / stats->staggered
+                                     : 0,
+                    stats->maxDelayed);
+  }
+}
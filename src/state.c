@@ -19,6 +19,10 @@
  *****************************************************************************/
 
 #include "state.h"
+#include "options.h"
+#include "session.h"
+#include "pressure.h"
+#include "prespawn.h"
 #include "miscutil.h"
 
 const char* progName          = 0;     /* our own name                       */
@@ -28,8 +32,6 @@ unsigned    nofArgs           = 0;     /* number of command line arguments   */
 Bool        disabled          = False; /* whether to ignore all timeouts     */
 Bool        lockNow           = False; /* whether to lock immediately        */
 Bool        unlockNow         = False; /* whether to unlock immediately      */
-time_t      lockTrigger       = 0;     /* time at which to invoke the locker */
-time_t      killTrigger       = 0;     /* time at which to invoke the killer */
 pid_t       lockerPid         = 0;     /* process id of the current locker   */
 volatile sig_atomic_t exitNow = 0;     /* whether to exit immediately        */
 Bool        restart           = False; /* whether to restart when exiting    */
@@ -83,3 +85,103 @@ initState (int argc, char* argv[])
   }
 #endif /* VMS */
 }
+
+/*
+ *  Trigger support. All of the triggers are timers (see timer.c), but
+ *  the rest of the world speaks seconds. The lock trigger proper may be
+ *  overruled by a corner one, and the notify trigger follows whichever
+ *  of them expires first.
+ */
+msecs
+lockDeadline (void)
+{
+  msecs deadline = timerDeadline (tm_lock);
+  int   t;                                   /* loop counter */
+
+  for (t = tm_corner - 1; ++t <= tm_redelay; )
+  {
+    if (timerArmed (t) && (!deadline || timerDeadline (t) < deadline))
+    {
+      deadline = timerDeadline (t);
+    }
+  }
+
+  return deadline;
+}
+
+static void
+setNotifyTrigger (void)
+{
+  if (notifyLock) armTimer (tm_notify, lockDeadline () - notifyMargin * 1000);
+}
+
+/*
+ *  A locker started ahead of time is of no use once the deadline moves,
+ *  so it gets sent away, and another one started when the time comes.
+ */
+static void
+setPrespawnTrigger (void)
+{
+  time_t margin = notifyLock ? notifyMargin : PRESPAWN_MARGIN;
+
+  if (prespawn) armTimer (tm_prespawn, lockDeadline () - margin * 1000);
+}
+
+static void
+armLockTimer (time_t delta)
+{
+  cancelPrespawn ();
+  disarmTimer (tm_corner);
+  disarmTimer (tm_redelay);
+  armTimer (tm_lock, monotonicNow () + delta * 1000);
+  setNotifyTrigger ();
+  setPrespawnTrigger ();
+}
+
+void
+setLockTrigger (time_t delta)
+{
+  trace (tr_lockTrigger, delta, 0);
+  armLockTimer (delta);
+}
+
+void
+setKillTrigger (time_t delta)
+{
+  trace (tr_killTrigger, delta, 0);
+  armTimer (tm_kill, monotonicNow () + delta * 1000);
+}
+
+/*
+ *  Function for dealing with the pointer sitting in a force-lock corner.
+ *  Only the first call counts, until the pointer moves again.
+ */
+void
+setCornerTrigger (time_t delta, Bool redelay)
+{
+  timerId timer = redelay ? tm_redelay : tm_corner;
+
+  if (!timerArmed (timer))
+  {
+    trace (tr_corner, delta, redelay);
+    armTimer (timer, monotonicNow () + delta * 1000);
+    setNotifyTrigger ();
+    setPrespawnTrigger ();
+  }
+}
+
+/*
+ *  Activity, or whatever counts as such, also brings a frozen session
+ *  back to life and stops any memory reclaim going on.
+ */
+void
+resetTriggers (void)
+{
+  trace (tr_activity, 0, 0);
+  sessionActivity ();
+  armLockTimer (lockTime);
+  if (killTriggerSet ())
+  {
+    armTimer (tm_kill, monotonicNow () + killDelay () * 1000);
+  }
+}
@@ -0,0 +1,190 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          the timers everything else is driven by.
+ *
+ *          All deadlines are kept in milliseconds on the CLOCK_BOOTTIME
+ *          scale (CLOCK_MONOTONIC where there's no such thing), so that
+ *          setting the clock (by hand or through NTP) doesn't make us
+ *          lock too soon or too late, while suspending the machine does
+ *          not postpone the lock either. The armed timers
+ *          are kept in a small binary heap, such that the main loop can
+ *          easily find out how long it may sleep.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "timer.h"
+#include "display.h"
+#include "miscutil.h"
+
+const char* timerNames[tm_count] =
+  { "lock", "kill", "notify", "corner", "redelay", "poll", "latency",
+    "reclaim", "pressure", "session", "prespawn" };
+
+static struct
+{
+  msecs deadline; /* as it says                               */
+  int   position; /* index in the heap plus one, 0 if unarmed */
+} timers[tm_count];
+
+static timerId heap[tm_count]; /* earliest deadline first */
+static int     heapSize = 0;   /* as it says              */
+
+/*
+ *  Heap maintenance.
+ */
+#define deadlineAt(i) (timers[heap[i]].deadline)
+
+static void
+swapEntries (int a, int b)
+{
+  timerId tmp = heap[a];
+
+  heap[a] = heap[b];
+  heap[b] = tmp;
+  timers[heap[a]].position = a + 1;
+  timers[heap[b]].position = b + 1;
+}
+
+static void
+siftUp (int i)
+{
+  while (i > 0 && deadlineAt ((i - 1) / 2) > deadlineAt (i))
+  {
+    swapEntries (i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+}
+
+static void
+siftDown (int i)
+{
+  int smallest; /* as it says   */
+  int child;    /* loop counter */
+
+  for (;;)
+  {
+    smallest = i;
+
+    for (child = 2 * i; ++child <= 2 * i + 2; )
+    {
+      if (child < heapSize && deadlineAt (child) < deadlineAt (smallest))
+      {
+        smallest = child;
+      }
+    }
+
+    if (smallest == i) return;
+
+    swapEntries (i, smallest);
+    i = smallest;
+  }
+}
+
+/*
+ *  Function for reading the clock. Normally CLOCK_BOOTTIME, but
+ *  that's up to the display layer.
+ */
+msecs
+monotonicNow (void)
+{
+  return dpy->now ();
+}
+
+/*
+ *  Function for (re)arming a timer.
+ */
+void
+armTimer (timerId timer, msecs deadline)
+{
+  int i; /* as it says */
+
+  if (!timers[timer].position)
+  {
+    heap[heapSize] = timer;
+    timers[timer].position = ++heapSize;
+  }
+
+  timers[timer].deadline = deadline;
+  i = timers[timer].position - 1;
+  siftUp (i);
+  siftDown (timers[timer].position - 1);
+}
+
+void
+disarmTimer (timerId timer)
+{
+  int i = timers[timer].position - 1;
+
+  if (i < 0) return;
+
+  timers[timer].position = 0;
+
+  if (i != --heapSize)
+  {
+    heap[i] = heap[heapSize];
+    timers[heap[i]].position = i + 1;
+    siftUp (i);
+    siftDown (timers[heap[i]].position - 1);
+  }
+}
+
+Bool
+timerArmed (timerId timer)
+{
+  return timers[timer].position != 0;
+}
+
+/*
+ *  Function for finding out when a timer will expire. Returns 0 if
+ *  it isn't armed.
+ */
+msecs
+timerDeadline (timerId timer)
+{
+  return timers[timer].position ? timers[timer].deadline : 0;
+}
+
+Bool
+timerExpired (timerId timer, msecs now)
+{
+  return timers[timer].position && timers[timer].deadline <= now;
+}
+
+/*
+ *  Function for finding out when the next timer expires. Timers that
+ *  already did, but were not taken care of (say, because the locker
+ *  couldn't be started), are not taken into account. Returns 0 if
+ *  there's nothing to wait for.
+ */
+msecs
+nextDeadline (msecs now)
+{
+  msecs next = 0; /* as it says   */
+  int   i;        /* loop counter */
+
+  if (heapSize && deadlineAt (0) > now) return deadlineAt (0);
+
+  for (i = 0; i < heapSize; ++i)
+  {
+    if (deadlineAt (i) > now && (!next || deadlineAt (i) < next))
+    {
+      next = deadlineAt (i);
+    }
+  }
+
+  return next;
+}
@@ -0,0 +1,169 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          the flight recorder.
+ *
+ *          With stderr closed, there's no telling what went on when a
+ *          session failed to lock. So we keep the last TRACE_SIZE
+ *          interesting things that happened in a ring of fixed size
+ *          binary records, which costs a coarse clock read and a few
+ *          stores each. The ring is written to a file on SIGUSR1 or
+ *          when asked to with -dumptrace, and tools/tracedump turns
+ *          that into something readable.
+ *
+ *          Dumping only uses async-signal-safe calls, so it can be done
+ *          right from the signal handler, even if the main loop got
+ *          stuck somewhere. There's only one writer, which fills in
+ *          a record before moving on to the next one, so the worst a
+ *          dump can get is one half-written record.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "trace.h"
+#include "state.h"
+#include "miscutil.h"
+
+#include <errno.h>
+
+#ifndef CLOCK_MONOTONIC_COARSE
+#define CLOCK_MONOTONIC_COARSE CLOCK_MONOTONIC
+#endif /* CLOCK_MONOTONIC_COARSE */
+
+static traceRecord            ring[TRACE_SIZE];     /* as it says          */
+static volatile unsigned long next = 0;             /* records written     */
+static char                   dumpFile[256] = "";   /* where to dump it    */
+
+static long long
+coarseNow (void)
+{
+  struct timespec now;
+
+  (void) clock_gettime (CLOCK_MONOTONIC_COARSE, &now);
+  return (long long) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/*
+ *  Function for recording an event.
+ */
+void
+trace (traceType type, long long arg1, long long arg2)
+{
+  traceRecord* record;
+
+  if (next)
+  {
+    record = &ring[(next - 1) % TRACE_SIZE];
+
+    if (   record->type == type
+        && record->arg1 == arg1
+        && record->arg2 == arg2)
+    {
+      ++record->repeats;
+      return;
+    }
+  }
+
+  record = &ring[next % TRACE_SIZE];
+  record->stamp = coarseNow ();
+  record->arg1 = arg1;
+  record->arg2 = arg2;
+  record->type = type;
+  record->repeats = 0;
+  ++next;
+}
+
+/*
+ *  Function for writing the ring to dumpFile. Returns False if that
+ *  didn't work out. Mind the comment at the top before changing
+ *  anything here.
+ */
+static Bool
+writeAll (int fd, const void* data, size_t length)
+{
+  const char* ptr = (const char*) data;
+  ssize_t     written;
+
+  while (length)
+  {
+    if ((written = write (fd, ptr, length)) <= 0) return False; /* = intended */
+    ptr += written;
+    length -= written;
+  }
+
+  return True;
+}
+
+Bool
+dumpTrace (void)
+{
+#ifndef VMS
+  traceHeader header; /* as it says */
+  int         fd;     /* as it says */
+  Bool        ok;     /* as it says */
+
+  (void) memset (&header, 0, sizeof (header));
+  (void) memcpy (header.magic, TRACE_MAGIC, sizeof (header.magic));
+  header.version = TRACE_VERSION;
+  header.recordSize = sizeof (traceRecord);
+  header.nofRecords = TRACE_SIZE;
+  header.next = next;
+  header.stamp = coarseNow ();
+  header.wallClock = time ((time_t*) 0);
+  header.pid = getpid ();
+
+  if ((fd = open (dumpFile, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW,
+                  0600)) < 0)
+  {
+    return False;
+  }
+
+  ok =    writeAll (fd, &header, sizeof (header))
+       && writeAll (fd, ring, sizeof (ring));
+
+  return close (fd) == 0 && ok;
+#else /* VMS */
+  return False;
+#endif /* VMS */
+}
+
+static void
+dumpSignalHandler (int sig)
+{
+  int savedErrno = errno;
+
+  (void) dumpTrace ();
+  errno = savedErrno;
+}
+
+/*
+ *  Function for setting things up.
+ */
+void
+initTrace (void)
+{
+#ifndef VMS
+  struct sigaction action; /* as it says */
+
+  (void) snprintf (dumpFile, sizeof (dumpFile), TRACE_FILE,
+                   progName, (long) getpid ());
+
+  (void) memset (&action, 0, sizeof (action));
+  action.sa_handler = dumpSignalHandler;
+  action.sa_flags = SA_RESTART;
+  (void) sigemptyset (&action.sa_mask);
+  (void) sigaction (SIGUSR1, &action, (struct sigaction*) 0);
+#endif /* VMS */
+}
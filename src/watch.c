@@ -0,0 +1,105 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          the stuff used to have the main loop wait for file descriptors
+ *          other than the X connection.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "watch.h"
+#include "miscutil.h"
+
+#define MAX_WATCHES 32 /* as it says */
+
+static struct
+{
+  int          fd;      /* as it says */
+  watchHandler handler; /* as it says */
+} watches[MAX_WATCHES];
+
+static int nofWatches = 0;
+
+/*
+ *  Function for registering a file descriptor. Returns False if
+ *  there is no room left, or if select() can't cope with it, in
+ *  which case the caller will have to find some other way.
+ */
+Bool
+addWatch (int fd, watchHandler handler)
+{
+  if (nofWatches == MAX_WATCHES || fd >= FD_SETSIZE) return False;
+
+  watches[nofWatches].fd = fd;
+  watches[nofWatches].handler = handler;
+  ++nofWatches;
+
+  return True;
+}
+
+void
+removeWatch (int fd)
+{
+  int w;
+
+  for (w = -1; ++w < nofWatches; )
+  {
+    if (watches[w].fd == fd)
+    {
+      watches[w] = watches[--nofWatches];
+      return;
+    }
+  }
+}
+
+/*
+ *  Function for adding all watched file descriptors to a set about
+ *  to be passed to select(). Returns the highest one.
+ */
+int
+setWatches (fd_set* fds, int maxFd)
+{
+  int w;
+
+  for (w = -1; ++w < nofWatches; )
+  {
+    FD_SET (watches[w].fd, fds);
+    maxFd = MAX (maxFd, watches[w].fd);
+  }
+
+  return maxFd;
+}
+
+/*
+ *  Function for calling the handlers of all file descriptors that
+ *  select() found to be ready. Handlers may remove their own watch.
+ */
+Bool
+handleWatches (Display* d, fd_set* fds)
+{
+  Bool stopWaiting = False;
+  int  w;
+
+  for (w = nofWatches; --w >= 0; )
+  {
+    if (w < nofWatches && FD_ISSET (watches[w].fd, fds))
+    {
+      FD_CLR (watches[w].fd, fds);
+      if ((*watches[w].handler) (d, watches[w].fd)) stopWaiting = True;
+    }
+  }
+
+  return stopWaiting;
+}
@@ -26,15 +26,26 @@
 #include "diy.h"
 #include "message.h"
 #include "engine.h"
+#include "launch.h"
+#include "hook.h"
+#include "clocks.h"
+#include "metrics.h"
+#include "profile.h"
+#include "session.h"
+#include "pressure.h"
+#include "stagger.h"
+#include "prespawn.h"
+#include "trace.h"
 
 /*
  *  X error handler. We can safely ignore everything
  *  here (mainly windows that die before we get even
- *  see them).
+ *  see them), but keep a note of it anyway.
  */
 static int
-catchFalseAlarm (Display* d, XErrorEvent event)
+catchFalseAlarm (Display* d, XErrorEvent* event)
 {
+  trace (tr_xError, event->error_code, event->request_code);
   return 0;
 }
 
@@ -105,9 +116,10 @@ int
 main (int argc, char* argv[])
 {
   Display*     d;
-  time_t       t0, t1;
+  msecs        now, next;
   Bool         useMit = False;
   Bool         useXidle = False;
+  Bool         look;
 
  /*
   *  Find out whether there actually is a server on the other side...
@@ -127,24 +139,54 @@ main (int argc, char* argv[])
   (void) XSetErrorHandler ((XErrorHandler) catchFalseAlarm);
   checkConnectionAndSendMessage (d, w);
   resetTriggers ();
-
-  if (!noCloseOut) (void) fclose (stdout);
-  if (!noCloseErr) (void) fclose (stderr);
+  initMetrics ();
+  initProfile ();
+  initTrace ();
 
 #ifdef HasXidle
-  queryExtension (Xidle, useXidle)
+  if (backend == bk_auto || backend == bk_xidle)
+  {
+    queryExtension (Xidle, useXidle)
+  }
 #endif /* HasXidle */
 
 #ifdef HasScreenSaver
-  if (!useXidle) queryExtension (XScreenSaver, useMit)
+  if (!useXidle && (backend == bk_auto || backend == bk_mit))
+  {
+    queryExtension (XScreenSaver, useMit)
+  }
 #endif /* HasScreenSaver */
 
+  if (   (backend == bk_xidle && !useXidle)
+      || (backend == bk_mit && !useMit))
+  {
+    error1 ("%s: the requested backend is not available.\n", progName);
+    exit (EXIT_FAILURE);
+  }
+
+ /*
+  *  Before stderr goes, as this may have something to say.
+  */
+  watchPressure ();
+  openStagger ();
+
+  if (!noCloseOut) (void) fclose (stdout);
+  if (!noCloseErr) (void) fclose (stderr);
+
   if (!useXidle && !useMit) initDiy (d);
 
+#ifndef VMS
+ /*
+  *  Keep the X connection away from anything we start.
+  */
+  (void) fcntl (ConnectionNumber (d), F_SETFD, FD_CLOEXEC);
+#endif /* VMS */
+
+  findServer (d);
+
+  watchClocks ();
   (void) XSync (d, 0);
 
-  t0 = time (NULL);
-  
   struct sigaction action;  
   action.sa_handler = signalHandler;
   
@@ -152,32 +194,71 @@ main (int argc, char* argv[])
   (void) sigaction(SIGTERM, &action, NULL);
 
  /*
-  *  Main event loop. lookForMessages waits 1 second each cycle
+  *  Main event loop. Each cycle sleeps until the next timer expires.
+  *  The poll timer makes sure that happens at least once per second,
+  *  except while a locker is running that we'll hear about the moment
+  *  it exits and there's no hook to watch. Then there's nothing to do
+  *  until the locker exits, the kill timer expires or a message comes
+  *  in. Unless the session has been frozen or is having its memory
+  *  reclaimed, that is, as the user should get it back the moment they
+  *  return.
   */
   while (!exitNow)
   {
+    ++metrics.wakeups;
+
+    if (!lockerTracked () || hooksRunning () || sessionWatched ())
+    {
+      armTimer (tm_poll, monotonicNow () + POLL_INTERVAL);
+    }
+    else
+    {
+      disarmTimer (tm_poll);
+    }
+
+    startProfile (d);
+    look = lookAtUser (!useXidle && !useMit);
+
     if (useXidle || useMit)
     {
-      queryIdleTime (d, useXidle);
+      if (look) queryIdleTime (d, useXidle);
+      endPhase (d, pp_idle);
     }
     else
     {
       processEvents ();
+      endPhase (d, pp_diy);
     }
 
-    queryPointer (d);
+    if (look && pointerNeeded (!useXidle && !useMit)) queryPointer (d);
+    endPhase (d, pp_pointer);
+    if (detectSleep) checkClocks ();
     evaluateTriggers (d);
+    endPhase (d, pp_triggers);
 
-    if (detectSleep)
-    {
-      t1 = time (NULL);
-      if ((unsigned long) t1 - (unsigned long) t0 > 3) resetLockTrigger ();
-      t0 = t1;
-    }
-    lookForMessages (d, 1);
+    now = monotonicNow ();
+    next = nextDeadline (now);
+    lookForMessages (d, next ? (next - now) / 1000.0 : -1);
+    endPhase (d, pp_messages);
   }
   
+  cancelPrespawn ();
+  checkPrespawn ();
+  sessionUnlocked ();
   cleanupSemaphore (d);
+  cleanupMetrics ();
+  cleanupProfile ();
+  if (noCloseErr)
+  {
+    reportSpawnStats ();
+    reportHookStats ();
+    reportClockStats ();
+    reportSessionStats ();
+    reportPressureStats ();
+    reportStaggerStats ();
+    reportPrespawnStats ();
+  }
+
   if (restart)
   {
     execv (argArray[0], argArray);
@@ -0,0 +1,268 @@
+#!/bin/sh
+#
+#  Benchmark for xautolock. Starts an Xvfb, and runs xautolock on it once
+#  for every backend while xactivity plays a user that is busy for a
+#  while, then walks away until the screen gets locked, a number of times
+#  over. The user is either a made up one, or a real one recorded with
+#  xactivity -record and given with -trace, so that every backend gets
+#  to see the very same activity. Writes one line of JSON per backend to
+#  the results file:
+#
+#    backend              as it says
+#    trace                the -trace file, or null
+#    status               "ok", or "unavailable" if not compiled in or
+#                         not supported by Xvfb
+#    seconds              how long xautolock ran
+#    cpu_seconds_per_hour user + system CPU time, scaled to an hour
+#    wakeups_per_second   main loop iterations
+#    x_requests_per_second
+#    rss_kb, max_rss_kb   VmRSS and VmHWM at the end
+#    idle_to_lock_ms      mean and max of the time between the last
+#                         activity plus the lock time and the locker
+#                         being started
+#    lock_spawn_ms        p50 of the time between the lock deadline and
+#                         the locker being started, as per -locklatency
+#    activity_to_reset_ms the difference of the above: how late the lock
+#                         deadline was, i.e. how long it took xautolock
+#                         to notice the last activity
+#    false_idle_locks     locks that came more than a second before the
+#                         lock time had passed since the last activity,
+#                         i.e. activity that xautolock missed
+#    false_idle_rate      the latter, as a fraction of all locks
+#
+#  Usage: bench.sh [-o results] [-cycles n] [-active secs] [-trace file]
+#                  [backend ...]
+#
+#  The backends default to xidle, mit and diy. Each cycle takes the
+#  -active time, or the length of the trace, plus a minute, the minimum
+#  lock time. Only the first lock after some activity counts. The
+#  xautolock and xactivity binaries are taken from $XAUTOLOCK and
+#  $XACTIVITY, or from the source tree. Needs Xvfb with the XTEST
+#  extension.
+#
+#  Please send bug reports etc. to mce@scarlet.be.
+#
+
+here=`dirname "$0"`
+XAUTOLOCK=${XAUTOLOCK:-$here/../xautolock}
+XACTIVITY=${XACTIVITY:-$here/xactivity}
+XVFB=${XVFB:-Xvfb}
+
+results=bench-results.jsonl
+cycles=3
+active=30
+trace=
+lockSecs=60
+
+while [ $# -gt 0 ]
+do
+  case "$1" in
+    -o)      results="$2"; shift 2 ;;
+    -cycles) cycles="$2";  shift 2 ;;
+    -active) active="$2";  shift 2 ;;
+    -trace)  trace="$2";   shift 2 ;;
+    -*)      echo "Usage: $0 [-o results] [-cycles n] [-active secs]" \
+                  "[-trace file] [backend ...]" >&2
+             exit 1 ;;
+    *)       break ;;
+  esac
+done
+
+backends=${*:-"xidle mit diy"}
+
+for f in "$XAUTOLOCK" "$XACTIVITY"
+do
+  if [ ! -x "$f" ]
+  then
+    echo "$0: $f not found, build it first." >&2
+    exit 1
+  fi
+done
+
+if [ -n "$trace" ] && [ ! -r "$trace" ]
+then
+  echo "$0: can't read $trace." >&2
+  exit 1
+fi
+
+work=`mktemp -d /tmp/xautolock-bench.XXXXXX` || exit 1
+xvfbPid=
+daemonPid=
+
+cleanup ()
+{
+  [ -n "$daemonPid" ] && kill $daemonPid 2>/dev/null
+  [ -n "$xvfbPid" ] && kill $xvfbPid 2>/dev/null
+  rm -rf "$work"
+}
+
+trap cleanup EXIT
+trap 'exit 1' INT TERM
+
+#
+#  Find a free display and start the server on it.
+#
+display=99
+
+while [ -e /tmp/.X$display-lock ]
+do
+  display=`expr $display + 1`
+done
+
+$XVFB :$display -screen 0 1280x1024x24 -nolisten tcp >"$work/xvfb.log" 2>&1 &
+xvfbPid=$!
+DISPLAY=:$display
+export DISPLAY
+
+tries=0
+until "$XACTIVITY" /dev/null 2>/dev/null
+do
+  tries=`expr $tries + 1`
+
+  if [ $tries -gt 50 ] || ! kill -0 $xvfbPid 2>/dev/null
+  then
+    echo "$0: Xvfb didn't come up:" >&2
+    cat "$work/xvfb.log" >&2
+    exit 1
+  fi
+
+  sleep 0.1
+done
+
+#
+#  What the user does while active: either what the trace says, or move
+#  around a bit, type now and then, and click once in a while.
+#
+script="$work/active.script"
+
+if [ -n "$trace" ]
+then
+  cp "$trace" "$script"
+else
+  {
+    i=0
+    while [ $i -lt $active ]
+    do
+      echo "move `expr $i \* 37 % 1280` `expr $i \* 53 % 1024`"
+      echo "sleep 250"
+      echo "move `expr $i \* 37 % 1280 + 5` `expr $i \* 53 % 1024 + 5`"
+      echo "sleep 250"
+      echo "key a"
+      echo "sleep 250"
+      [ `expr $i % 5` -eq 0 ] && echo "button 1" || echo "key space"
+      echo "sleep 250"
+      i=`expr $i + 1`
+    done
+  } >"$script"
+fi
+
+now ()
+{
+  "$XACTIVITY" -stamp now | cut -d' ' -f2
+}
+
+locks ()
+{
+  grep -c '^locked ' "$stamps" 2>/dev/null || echo 0
+}
+
+ticks=`getconf CLK_TCK`
+version=`"$XAUTOLOCK" -version 2>&1 | sed 's/.*version //'`
+
+for backend in $backends
+do
+  stamps="$work/$backend.stamps"
+  profile="$work/$backend.profile"
+  : >"$stamps"
+
+  "$XAUTOLOCK" -backend $backend -time 1 -id bench -nocloseerr \
+               -locker "$XACTIVITY -o $stamps -stamp locked" \
+               -profile "$profile" 2>"$work/$backend.log" &
+  daemonPid=$!
+  started=`now`
+  sleep 1
+
+  if ! kill -0 $daemonPid 2>/dev/null
+  then
+    daemonPid=
+    echo "{\"backend\":\"$backend\",\"version\":\"$version\"," \
+         "\"status\":\"unavailable\"}" >>"$results"
+    continue
+  fi
+
+  cycle=0
+  while [ $cycle -lt $cycles ]
+  do
+    before=`locks`
+    "$XACTIVITY" -o "$stamps" "$script"
+
+    waited=0
+    while [ `locks` -le $before ] && [ $waited -lt `expr $lockSecs + 30` ]
+    do
+      sleep 1
+      waited=`expr $waited + 1`
+    done
+
+    cycle=`expr $cycle + 1`
+  done
+
+  spawn=`"$XAUTOLOCK" -id bench -locklatency 2>/dev/null \
+         | awk '$1 == "locker" && $2 == "spawned" { print $4 }'`
+  stopped=`now`
+  cpu=`awk '{ print $14 + $15 }' /proc/$daemonPid/stat`
+  rss=`awk '/^VmRSS:/ { print $2 }' /proc/$daemonPid/status`
+  maxRss=`awk '/^VmHWM:/ { print $2 }' /proc/$daemonPid/status`
+
+  kill $daemonPid
+  wait $daemonPid 2>/dev/null
+  daemonPid=
+
+  awk -v backend="$backend" -v version="$version" -v started="$started" \
+      -v stopped="$stopped" -v cpu="$cpu" -v ticks="$ticks" \
+      -v rss="$rss" -v maxRss="$maxRss" -v spawn="${spawn:--}" \
+      -v lockSecs="$lockSecs" -v trace="$trace" '
+    FILENAME ~ /stamps$/ && $1 == "activity" { last = $2; locked = 0 }
+    FILENAME ~ /stamps$/ && $1 == "locked" && last && !locked {
+      late = ($2 - last - lockSecs) * 1000
+      locked = 1
+      if (late < -1000)
+      {
+        ++falseIdle
+        next
+      }
+      sum += late; ++n
+      if (late > max) max = late
+    }
+    FILENAME ~ /profile$/ && $1 == "total" {
+      seconds = $3
+      requests += $8
+      if ($4 == "messages") wakeups = $5
+    }
+    END {
+      elapsed = stopped - started
+      mean = n ? sum / n : -1
+      printf "{\"backend\":\"%s\",\"version\":\"%s\",\"status\":\"ok\",", \
+             backend, version
+      printf "\"trace\":%s,", trace == "" ? "null" : "\"" trace "\""
+      printf "\"seconds\":%.1f,\"cycles\":%d,", elapsed, n
+      printf "\"cpu_seconds_per_hour\":%.3f,", cpu / ticks / elapsed * 3600
+      printf "\"wakeups_per_second\":%.3f,", seconds ? wakeups / seconds : 0
+      printf "\"x_requests_per_second\":%.3f,", \
+             seconds ? requests / seconds : 0
+      printf "\"rss_kb\":%d,\"max_rss_kb\":%d,", rss, maxRss
+      printf "\"idle_to_lock_ms\":{\"mean\":%.1f,\"max\":%.1f},", mean, max
+      printf "\"false_idle_locks\":%d,\"false_idle_rate\":%.3f,", \
+             falseIdle, n + falseIdle ? falseIdle / (n + falseIdle) : 0
+      if (spawn == "-")
+      {
+        printf "\"lock_spawn_ms\":null,\"activity_to_reset_ms\":null}\n"
+      }
+      else
+      {
+        printf "\"lock_spawn_ms\":%d,\"activity_to_reset_ms\":%.1f}\n", \
+               spawn, n ? mean - spawn : -1
+      }
+    }' "$stamps" "$profile" >>"$results"
+done
+
+echo "Results appended to $results."
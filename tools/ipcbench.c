@@ -0,0 +1,447 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          a little tool that hammers a running xautolock with messages,
+ *          like -isdisabled, -toggle, -enable and -disable do, and reports
+ *          how long the answers take.
+ *
+ *          Usage: ipcbench [-id id] [-clients n] [-requests n]
+ *                          [-seconds n] [-mix list] [-timeout ms]
+ *                          [-seed n]
+ *
+ *          Starts -clients clients, each with an X connection of its own,
+ *          just like that many status bars. Each of them sends a message,
+ *          waits for the answer (or for -timeout milliseconds, 1000 by
+ *          default, which is how long xautolock itself waits), and sends
+ *          the next, until -requests messages (10000 by default) have
+ *          been answered in total, or -seconds have passed.
+ *
+ *          The list given to -mix reads "name:weight,...", the names being
+ *          isdisabled, toggle, enable and disable. The default is
+ *          "isdisabled:8,toggle:2". Whether xautolock was disabled is
+ *          restored in the end. In -secure mode, xautolock denies all but
+ *          isdisabled, which still makes for a valid round trip.
+ *
+ *          Prints the count, the number of timeouts and denials, and the
+ *          p50, p99 and p999 latency in microseconds per message, plus
+ *          the overall throughput. ClientMessages are the only way to
+ *          talk to xautolock, so that's all this covers.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "message.h"
+
+#include <poll.h>
+
+#define MAX_CLIENTS 256 /* as it says */
+
+static const struct
+{
+  const char* name;    /* as it says */
+  message     message; /* as it says */
+} kinds[] =
+{
+  {"isdisabled", msg_isDisabled},
+  {"toggle"    , msg_toggle    },
+  {"enable"    , msg_enable    },
+  {"disable"   , msg_disable   },
+};
+
+#define NOF_KINDS ((int) (sizeof (kinds) / sizeof (kinds[0])))
+
+typedef struct
+{
+  long*         samples;  /* latencies, in microseconds */
+  unsigned long count;    /* as it says                 */
+  unsigned long size;     /* of samples                 */
+  unsigned long timeouts; /* as it says                 */
+  unsigned long denials;  /* as it says                 */
+} kindStats;
+
+typedef struct
+{
+  Display* d;       /* own connection           */
+  Window   w;       /* where answers come to    */
+  int      kind;    /* of the outstanding one   */
+  long     sentAt;  /* as it says, microseconds */
+} client;
+
+static kindStats stats[NOF_KINDS];
+static int       weights[NOF_KINDS];
+static int       totalWeight = 0;
+static Atom      requestAtom;
+static Atom      responseAtom;
+static Window    target;          /* xautolock's window */
+
+static long
+microNow (void)
+{
+  struct timespec now;
+
+  (void) clock_gettime (CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/*
+ *  Function for finding xautolock, the same way xautolock does itself.
+ */
+static Bool
+findTarget (Display* d, const char* id)
+{
+  char           name[256];  /* as it says      */
+  char*          ptr;        /* iterator        */
+  Atom           semaphore;  /* as it says      */
+  Atom           type;       /* as it says      */
+  int            format;     /* dummy           */
+  unsigned long  nofItems;   /* as it says      */
+  unsigned long  after;      /* dummy           */
+  unsigned char* contents;   /* as it says      */
+
+  (void) snprintf (name, sizeof (name), "xautolock_SEMAPHORE_WINDOW_%s", id);
+  for (ptr = name; *ptr; ++ptr) *ptr = (char) toupper (*ptr);
+  semaphore = XInternAtom (d, name, True);
+
+  requestAtom = XInternAtom (d, "XAUTOLOCK_MESSAGE_REQUEST", False);
+  responseAtom = XInternAtom (d, "XAUTOLOCK_MESSAGE_RESPONSE", False);
+
+  if (   semaphore == None
+      || XGetWindowProperty (d, DefaultRootWindow (d), semaphore, 0L, 2L,
+                             False, AnyPropertyType, &type, &format,
+                             &nofItems, &after, &contents) != Success)
+  {
+    return False;
+  }
+
+  if (type != XA_INTEGER || nofItems < sizeof (Window))
+  {
+    if (contents) (void) XFree (contents);
+    return False;
+  }
+
+  (void) memcpy (&target, contents, sizeof (Window));
+  (void) XFree (contents);
+  return True;
+}
+
+/*
+ *  Function for sending a client's next message.
+ */
+static void
+sendNext (client* c, int kind)
+{
+  XEvent request;
+
+  (void) memset (&request, 0, sizeof (request));
+  request.type = ClientMessage;
+  request.xclient.display = c->d;
+  request.xclient.window = c->w;
+  request.xclient.message_type = requestAtom;
+  request.xclient.format = 32;
+  request.xclient.data.l[0] = kinds[kind].message;
+
+  c->kind = kind;
+  c->sentAt = microNow ();
+  (void) XSendEvent (c->d, target, False, 0, &request);
+  (void) XFlush (c->d);
+}
+
+static int
+kindOf (message m)
+{
+  int k;
+
+  for (k = 0; kinds[k].message != m; ++k);
+  return k;
+}
+
+static int
+pickKind (void)
+{
+  int pick = rand () % totalWeight;
+  int k;
+
+  for (k = 0; pick >= weights[k]; pick -= weights[k++]);
+  return k;
+}
+
+static void
+addSample (kindStats* s, long latency)
+{
+  if (s->count == s->size)
+  {
+    s->size = s->size ? s->size * 2 : 1024;
+
+    if (!(s->samples = realloc (s->samples, s->size * sizeof (long))))
+    {
+      (void) fprintf (stderr, "Out of memory.\n");
+      exit (EXIT_FAILURE);
+    }
+  }
+
+  s->samples[s->count++] = latency;
+}
+
+static int
+compareLongs (const void* a, const void* b)
+{
+  long x = *(const long*) a;
+  long y = *(const long*) b;
+
+  return x < y ? -1 : x > y;
+}
+
+static long
+percentile (long* samples, unsigned long count, double p)
+{
+  return count ? samples[(unsigned long) ((count - 1) * p / 100)] : -1;
+}
+
+static void
+printRow (const char* name, long* samples, unsigned long count,
+          unsigned long timeouts, unsigned long denials)
+{
+  qsort (samples, count, sizeof (long), compareLongs);
+  (void) printf ("%-10s %8lu %8lu %8lu %8ld %8ld %8ld\n", name, count,
+                 timeouts, denials, percentile (samples, count, 50),
+                 percentile (samples, count, 99),
+                 percentile (samples, count, 99.9));
+}
+
+/*
+ *  Function for parsing -mix.
+ */
+static Bool
+parseMix (const char* arg)
+{
+  char* list = strdup (arg);
+  char* item;
+  int   k;
+
+  (void) memset (weights, 0, sizeof (weights));
+
+  for (item = strtok (list, ","); item; item = strtok ((char*) 0, ","))
+  {
+    char* colon = strchr (item, ':');
+    int   weight = colon ? atoi (colon + 1) : 1;
+
+    if (colon) *colon = '\0';
+
+    for (k = -1; ++k < NOF_KINDS && strcmp (item, kinds[k].name); );
+    if (k == NOF_KINDS || weight < 0) return False;
+
+    weights[k] = weight;
+  }
+
+  for (k = -1, totalWeight = 0; ++k < NOF_KINDS; ) totalWeight += weights[k];
+  free (list);
+
+  return totalWeight > 0;
+}
+
+static void
+usage (const char* progName)
+{
+  (void) fprintf (stderr,
+                  "Usage : %s [-id id] [-clients n] [-requests n]\n"
+                  "        [-seconds n] [-mix list] [-timeout ms] [-seed n]\n",
+                  progName);
+  exit (EXIT_FAILURE);
+}
+
+int
+main (int argc, char* argv[])
+{
+  const char*   id = ID;              /* -id                             */
+  int           nofClients = 1;       /* -clients                        */
+  long          requests = 10000;     /* -requests                       */
+  long          seconds = 0;          /* -seconds, 0 for no limit        */
+  long          timeout = 1000;       /* -timeout, in milliseconds       */
+  client*       clients;              /* as it says                      */
+  struct pollfd fds[MAX_CLIENTS];     /* as it says                      */
+  long          answered = 0;         /* as it says                      */
+  long          start;                /* as it says                      */
+  long          now;                  /* as it says                      */
+  long          deadline;             /* -seconds, in microseconds       */
+  Bool          wasDisabled = False;  /* as it says                      */
+  long*         all;                  /* all samples, for the total      */
+  unsigned long nofAll = 0;           /* as it says                      */
+  unsigned long timeouts = 0;         /* as it says                      */
+  unsigned long denials = 0;          /* as it says                      */
+  int           a;                    /* loop counter                    */
+  int           c;                    /* loop counter                    */
+  int           k;                    /* loop counter                    */
+
+  (void) parseMix ("isdisabled:8,toggle:2");
+
+  for (a = 0; ++a < argc; )
+  {
+    if      (a + 1 >= argc)                     usage (argv[0]);
+    else if (!strcmp (argv[a], "-id"))        id = argv[++a];
+    else if (!strcmp (argv[a], "-clients"))   nofClients = atoi (argv[++a]);
+    else if (!strcmp (argv[a], "-requests"))  requests = atol (argv[++a]);
+    else if (!strcmp (argv[a], "-seconds"))   seconds = atol (argv[++a]);
+    else if (!strcmp (argv[a], "-timeout"))   timeout = atol (argv[++a]);
+    else if (!strcmp (argv[a], "-seed"))      srand (atoi (argv[++a]));
+    else if (!strcmp (argv[a], "-mix"))
+    {
+      if (!parseMix (argv[++a])) usage (argv[0]);
+    }
+    else                                        usage (argv[0]);
+  }
+
+  if (   nofClients < 1 || nofClients > MAX_CLIENTS
+      || requests < 1 || seconds < 0 || timeout < 1)
+  {
+    usage (argv[0]);
+  }
+
+  clients = (client*) calloc (nofClients, sizeof (client));
+
+  for (c = -1; ++c < nofClients; )
+  {
+    if (!(clients[c].d = XOpenDisplay (0))) /* = intended */
+    {
+      (void) fprintf (stderr, "Couldn't connect to %s\n", XDisplayName (0));
+      return EXIT_FAILURE;
+    }
+
+    if (!c && !findTarget (clients[c].d, id))
+    {
+      (void) fprintf (stderr, "Could not locate a running xautolock.\n");
+      return EXIT_FAILURE;
+    }
+
+    clients[c].w = XCreateSimpleWindow (clients[c].d,
+                                        DefaultRootWindow (clients[c].d),
+                                        0, 0, 1, 1, 0, 0, 0);
+    fds[c].fd = ConnectionNumber (clients[c].d);
+    fds[c].events = POLLIN;
+  }
+
+ /*
+  *  Remember whether xautolock was disabled, so that it can be put
+  *  back that way.
+  */
+  sendNext (&clients[0], kindOf (msg_isDisabled));
+
+  for (deadline = microNow () + timeout * 1000; microNow () < deadline; )
+  {
+    XEvent event;
+
+    if (XPending (clients[0].d))
+    {
+      (void) XNextEvent (clients[0].d, &event);
+
+      if (   event.type == ClientMessage
+          && event.xclient.message_type == responseAtom)
+      {
+        wasDisabled = ((fullResponse*) &event.xclient.data)->data[0];
+        break;
+      }
+    }
+    else
+    {
+      (void) poll (fds, 1, 10);
+    }
+  }
+
+  start = microNow ();
+  deadline = seconds ? start + seconds * 1000000 : 0;
+
+  for (c = -1; ++c < nofClients; ) sendNext (&clients[c], pickKind ());
+
+  while (   answered < requests
+         && (!deadline || (now = microNow ()) < deadline))
+  {
+    (void) poll (fds, nofClients, 10);
+    now = microNow ();
+
+    for (c = -1; ++c < nofClients; )
+    {
+      client* cl = &clients[c];
+      XEvent  event;
+
+      while (XPending (cl->d))
+      {
+        fullResponse* response;
+
+        (void) XNextEvent (cl->d, &event);
+
+        if (   event.type != ClientMessage
+            || event.xclient.message_type != responseAtom)
+        {
+          continue;
+        }
+
+        response = (fullResponse*) &event.xclient.data;
+        now = microNow ();
+        addSample (&stats[cl->kind], now - cl->sentAt);
+        if (response->type == response_failure) ++stats[cl->kind].denials;
+        ++answered;
+
+        sendNext (cl, pickKind ());
+      }
+
+      if (now - cl->sentAt > timeout * 1000)
+      {
+        ++stats[cl->kind].timeouts;
+        sendNext (cl, pickKind ());
+      }
+    }
+  }
+
+  now = microNow ();
+
+ /*
+  *  The report.
+  */
+  (void) printf ("%-10s %8s %8s %8s %8s %8s %8s\n", "message", "count",
+                 "timeouts", "denied", "p50 us", "p99 us", "p999 us");
+
+  all = (long*) malloc ((answered + 1) * sizeof (long));
+
+  for (k = -1; ++k < NOF_KINDS; )
+  {
+    if (!weights[k]) continue;
+
+    (void) memcpy (all + nofAll, stats[k].samples,
+                   stats[k].count * sizeof (long));
+    nofAll += stats[k].count;
+    timeouts += stats[k].timeouts;
+    denials += stats[k].denials;
+
+    printRow (kinds[k].name, stats[k].samples, stats[k].count,
+              stats[k].timeouts, stats[k].denials);
+  }
+
+  printRow ("total", all, nofAll, timeouts, denials);
+  (void) printf ("clients %d seconds %.3f throughput %.1f/s\n", nofClients,
+                 (now - start) / 1e6, answered * 1e6 / (now - start));
+
+ /*
+  *  Put things back the way they were, waiting for any stragglers
+  *  first.
+  */
+  if (weights[kindOf (msg_isDisabled)] < totalWeight)
+  {
+    (void) usleep (timeout * 1000);
+    sendNext (&clients[0], kindOf (wasDisabled ? msg_disable : msg_enable));
+    (void) XSync (clients[0].d, False);
+  }
+
+  for (c = -1; ++c < nofClients; ) (void) XCloseDisplay (clients[c].d);
+  return EXIT_SUCCESS;
+}
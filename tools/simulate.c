@@ -0,0 +1,562 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          a simulator that runs the xautolock main loop against a fake
+ *          display and a virtual clock, so that days of activity can be
+ *          played in a fraction of a second. Handy for checking what
+ *          the triggers do around the edges, and for benchmarking them.
+ *
+ *          Usage: simulate [-time mins] [-notify secs] [-corners xxxx]
+ *                          [-cornerdelay secs] [-cornerredelay secs]
+ *                          [-cornersize pixels] [-roundtrips n]
+ *                          [-days n] [-repeat n] [-verbose] [script]
+ *
+ *          The script (stdin if not given) tells what the user does,
+ *          one line per action, in order of time:
+ *
+ *            secs key          the user hits a key
+ *            secs busy n       the user hits a key every second for n
+ *                              seconds
+ *            secs move x y     the user moves the pointer to (x, y)
+ *
+ *          secs counts from the start of the day. The script gets played
+ *          once a day for -days days. The simulated screen is 1280x1024.
+ *          The locker locks the moment it is started, and exits as soon
+ *          as the user hits a key or moves the pointer again.
+ *
+ *          With -verbose, every lock, unlock and notification is
+ *          printed. In the end, the number of those, the number of round
+ *          trips xautolock would have needed, and the time it took are
+ *          printed. -repeat runs the whole thing n times over,
+ *          for benchmarking.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "display.h"
+#include "options.h"
+#include "state.h"
+#include "engine.h"
+#include "message.h"
+#include "timer.h"
+#include "miscutil.h"
+
+#define DAY    (24 * 3600 * 1000LL) /* as it says, in milliseconds       */
+#define EPOCH  1000                 /* virtual time starts here, since a
+                                       deadline of 0 means unarmed       */
+#define NO_PID 0x7f000000           /* fake locker pids start here, well
+                                       beyond any real pid_max          */
+
+typedef enum
+{
+  ua_key,    /* as it says */
+  ua_busy,   /* as it says */
+  ua_move    /* as it says */
+} userAction;
+
+typedef struct
+{
+  msecs      at;      /* milliseconds into the day */
+  userAction action;  /* as it says                */
+  long       arg1;    /* seconds, or x             */
+  long       arg2;    /* y                         */
+} scriptLine;
+
+static scriptLine* script = 0;     /* as it says                        */
+static int         scriptSize = 0; /* as it says                        */
+static long        days = 1;       /* -days                             */
+static Bool        verbose = False;/* -verbose                          */
+static msecs       runStart = EPOCH;
+                                   /* start of the current run; the clock
+                                      carries on from one to the next,
+                                      as the engine remembers things    */
+
+/*
+ *  The state of the simulated world.
+ */
+static struct
+{
+  msecs    now;        /* the virtual clock                        */
+  msecs    lastInput;  /* as it says                               */
+  int      next;       /* next script line, counting over all days */
+  msecs    busyUntil;  /* end of the current `busy' line           */
+  int      x, y;       /* pointer position                         */
+  pid_t    locker;     /* running fake locker, or 0                */
+  pid_t    lastPid;    /* as it says                               */
+  msecs    lockedAt;   /* when the locker started                  */
+  unsigned long locks;
+  unsigned long unlocks;
+  unsigned long bells;
+  unsigned long roundTrips;
+  unsigned long iterations;
+} world;
+
+static Screen    screen;  /* the simulated screen       */
+static Display*  display; /* fake, just enough for the
+                             macros the engine uses     */
+
+/*
+ *  Script handling.
+ */
+static msecs
+lineTime (int n)
+{
+  return runStart + (n / scriptSize) * DAY + script[n % scriptSize].at;
+}
+
+static msecs
+nextAction (void)
+{
+  if (world.busyUntil > world.lastInput)
+  {
+    return world.lastInput + 1000;
+  }
+
+  if (!scriptSize || world.next >= scriptSize * days) return 0;
+
+  return lineTime (world.next);
+}
+
+static void
+printTime (const char* what)
+{
+  msecs t = world.now - runStart;
+
+  (void) printf ("day %lld %02lld:%02lld:%02lld.%03lld %s\n",
+                 t / DAY, t % DAY / 3600000, t % 3600000 / 60000,
+                 t % 60000 / 1000, t % 1000, what);
+}
+
+/*
+ *  Function for making the world catch up with the virtual clock.
+ */
+static void
+playScript (void)
+{
+  while (   world.busyUntil > world.lastInput
+         && world.lastInput + 1000 <= world.now)
+  {
+    world.lastInput += 1000;
+  }
+
+  while (   world.next < scriptSize * days
+         && lineTime (world.next) <= world.now)
+  {
+    const scriptLine* line = &script[world.next % scriptSize];
+    msecs             at = lineTime (world.next++);
+
+    switch (line->action)
+    {
+      case ua_busy:
+        world.busyUntil = at + line->arg1 * 1000;
+        world.lastInput = at;
+        break;
+
+      case ua_key:
+        world.lastInput = at;
+        break;
+
+      case ua_move:
+        world.x = (int) line->arg1;
+        world.y = (int) line->arg2;
+        world.lastInput = at;
+        break;
+    }
+  }
+}
+
+/*
+ *  The fake display layer.
+ */
+static msecs
+fakeNow (void)
+{
+  return world.now;
+}
+
+/*
+ *  Instead of waiting, move the clock forward to the end of the timeout,
+ *  or to the next thing the user does, whichever comes first. The
+ *  simulation is over at the end of the last day.
+ */
+static int
+fakeWait (int nfds, fd_set* fds, struct timeval* timeout)
+{
+  msecs next = nextAction ();
+  msecs end = runStart + days * DAY;
+
+  if (timeout)
+  {
+    msecs until =   world.now + timeout->tv_sec * 1000
+                  + timeout->tv_usec / 1000;
+
+    if (!next || next > until) next = until;
+  }
+
+  if (!next || next >= end)
+  {
+    world.now = end;
+    exitNow = 1;
+    return 0;
+  }
+
+  if (next > world.now) world.now = next;
+  playScript ();
+
+  return 0;
+}
+
+static Time
+fakeQueryIdle (Display* d, Bool useXidle)
+{
+  ++world.roundTrips;
+  return (Time) (world.now - world.lastInput);
+}
+
+static void
+fakeQueryPointer (Display* d, int* x, int* y, unsigned* mask,
+                  Screen** where)
+{
+  ++world.roundTrips;
+  *x = world.x;
+  *y = world.y;
+  *mask = 0;
+  *where = &screen;
+}
+
+static int
+fakePending (Display* d)
+{
+  return 0;
+}
+
+static void
+fakeNextEvent (Display* d, XEvent* event)
+{
+  (void) memset (event, 0, sizeof (*event));
+}
+
+static Bool
+fakeCheckMaskEvent (Display* d, long mask, XEvent* event)
+{
+  return False;
+}
+
+static Status
+fakeSendEvent (Display* d, Window w, XEvent* event)
+{
+  return 1;
+}
+
+static void
+fakeSync (Display* d)
+{
+}
+
+static void
+fakeBell (Display* d, int percent)
+{
+  ++world.bells;
+  if (verbose) printTime ("notify");
+}
+
+static void
+fakeSelectInput (Display* d, Window w, long mask)
+{
+}
+
+static Status
+fakeGetAttributes (Display* d, Window w, XWindowAttributes* attribs)
+{
+  return 0;
+}
+
+static pid_t
+fakeLaunchLocker (commandType type)
+{
+  world.locker = world.lastPid = world.lastPid ? world.lastPid + 1 : NO_PID;
+  world.lockedAt = world.now;
+  ++world.locks;
+  if (verbose) printTime (type == cmd_nowLocker ? "lock now" : "lock");
+
+  return world.locker;
+}
+
+static pid_t
+fakeReapLocker (pid_t pid, int* status)
+{
+  if (pid != world.locker || world.lastInput <= world.lockedAt) return 0;
+
+  world.locker = 0;
+  ++world.unlocks;
+  *status = 0;
+  if (verbose) printTime ("unlock");
+
+  return pid;
+}
+
+static const displayOps fakeOps =
+{
+  "fake",
+  fakeNow,
+  fakeWait,
+  fakeQueryIdle,
+  fakeQueryPointer,
+  fakePending,
+  fakeNextEvent,
+  fakeCheckMaskEvent,
+  fakeSendEvent,
+  fakeSync,
+  fakeBell,
+  fakeSelectInput,
+  fakeGetAttributes,
+  fakeLaunchLocker,
+  fakeReapLocker
+};
+
+/*
+ *  Function for reading the script.
+ */
+static void
+readScript (FILE* file)
+{
+  char   line[256];    /* as it says   */
+  char   word[32];     /* as it says   */
+  double secs;         /* as it says   */
+  int    size = 0;     /* as it says   */
+  int    lineNr = 0;   /* as it says   */
+
+  while (fgets (line, sizeof (line), file))
+  {
+    scriptLine* s;
+
+    ++lineNr;
+    if (sscanf (line, "%31s", word) != 1 || *word == '#') continue;
+
+    if (scriptSize == size)
+    {
+      script = (scriptLine*) realloc (script,
+                                      (size += 64) * sizeof (scriptLine));
+      if (!script) exit (EXIT_FAILURE);
+    }
+
+    s = &script[scriptSize];
+    s->arg1 = s->arg2 = 0;
+
+    if (sscanf (line, "%lf %31s %ld %ld", &secs, word, &s->arg1, &s->arg2) < 2)
+    {
+      error1 ("Line %d: can't make sense of it.\n", lineNr);
+      exit (EXIT_FAILURE);
+    }
+
+    s->at = (msecs) (secs * 1000);
+
+    if      (!strcmp (word, "key"))  s->action = ua_key;
+    else if (!strcmp (word, "busy")) s->action = ua_busy;
+    else if (!strcmp (word, "move")) s->action = ua_move;
+    else
+    {
+      error2 ("Line %d: unknown action %s.\n", lineNr, word);
+      exit (EXIT_FAILURE);
+    }
+
+    if (   s->at < 0
+        || s->at >= DAY
+        || (scriptSize && s->at < script[scriptSize - 1].at))
+    {
+      error1 ("Line %d: time out of order or range.\n", lineNr);
+      exit (EXIT_FAILURE);
+    }
+
+    ++scriptSize;
+  }
+}
+
+/*
+ *  Function for running the main loop, exactly like xautolock does
+ *  in MIT-SCREEN-SAVER mode.
+ */
+static void
+simulate (void)
+{
+  msecs now, next;
+
+  (void) memset (&world, 0, sizeof (world));
+  world.now = world.lastInput = runStart;
+  world.x = world.y = -1;
+  lockerPid = 0;
+  exitNow = 0;
+
+  disarmTimer (tm_poll);
+  resetTriggers ();
+
+  while (!exitNow)
+  {
+    ++world.iterations;
+
+    if (!lockerTracked ())
+    {
+      armTimer (tm_poll, monotonicNow () + POLL_INTERVAL);
+    }
+    else
+    {
+      disarmTimer (tm_poll);
+    }
+
+    if (lookAtUser (False))
+    {
+      queryIdleTime (display, False);
+      if (pointerNeeded (False)) queryPointer (display);
+    }
+
+    evaluateTriggers (display);
+
+    now = monotonicNow ();
+    next = nextDeadline (now);
+    lookForMessages (display, next ? (next - now) / 1000.0 : -1);
+  }
+
+  runStart = world.now;
+}
+
+static void
+usage (void)
+{
+  error1 ("Usage : %s [-time mins] [-notify secs] [-corners xxxx]\n",
+          progName);
+  error0 ("        [-cornerdelay secs] [-cornerredelay secs]\n");
+  error0 ("        [-cornersize pixels] [-roundtrips n]\n");
+  error0 ("        [-days n] [-repeat n] [-verbose] [script]\n");
+  exit (EXIT_FAILURE);
+}
+
+int
+main (int argc, char* argv[])
+{
+  FILE*           file = stdin;  /* the script       */
+  long            repeat = 1;    /* -repeat          */
+  long            r;             /* loop counter     */
+  int             a;             /* loop counter     */
+  int             c;             /* loop counter     */
+  struct timespec start, end;    /* real time        */
+  double          elapsed;       /* same, in seconds */
+
+  initState (argc, argv);
+  lockTime = LOCK_MINS * 60;
+  killTime = KILL_MINS * 60;
+  cornerRedelay = cornerDelay;
+
+  for (a = 0; ++a < argc && *argv[a] == '-'; )
+  {
+    if (!strcmp (argv[a], "-verbose"))
+    {
+      verbose = True;
+      continue;
+    }
+
+    if (a + 1 >= argc) usage ();
+
+    if      (!strcmp (argv[a], "-time"))   lockTime = atol (argv[++a]) * 60;
+    else if (!strcmp (argv[a], "-days"))   days = atol (argv[++a]);
+    else if (!strcmp (argv[a], "-repeat")) repeat = atol (argv[++a]);
+    else if (!strcmp (argv[a], "-notify"))
+    {
+      notifyLock = True;
+      notifyMargin = atol (argv[++a]);
+    }
+    else if (!strcmp (argv[a], "-corners"))
+    {
+      if (strlen (argv[++a]) != 4) usage ();
+
+      for (c = -1; ++c < 4; )
+      {
+        switch (argv[a][c])
+        {
+          case '0': corners[c] = ca_ignore;    continue;
+          case '-': corners[c] = ca_dontLock;  continue;
+          case '+': corners[c] = ca_forceLock; continue;
+          default:  usage ();
+        }
+      }
+    }
+    else if (!strcmp (argv[a], "-cornerdelay"))
+    {
+      cornerRedelay = cornerDelay = atol (argv[++a]);
+    }
+    else if (!strcmp (argv[a], "-cornerredelay"))
+    {
+      cornerRedelay = atol (argv[++a]);
+    }
+    else if (!strcmp (argv[a], "-cornersize"))
+    {
+      cornerSize = atoi (argv[++a]);
+    }
+    else if (!strcmp (argv[a], "-roundtrips"))
+    {
+      maxRoundTrips = atoi (argv[++a]);
+    }
+    else
+    {
+      usage ();
+    }
+  }
+
+  if (a < argc - 1) usage ();
+
+  if (a < argc && !(file = fopen (argv[a], "r"))) /* = intended */
+  {
+    perror (argv[a]);
+    return EXIT_FAILURE;
+  }
+
+  if (   lockTime <= 0 || days < 1 || repeat < 1
+      || (maxRoundTrips && maxRoundTrips < MIN_ROUND_TRIPS))
+  {
+    usage ();
+  }
+
+  readScript (file);
+
+ /*
+  *  Just enough of a display for the Xlib macros the engine uses.
+  */
+  screen.width = 1280;
+  screen.height = 1024;
+  screen.root = 1;
+  display = (Display*) calloc (1, sizeof (*(_XPrivDisplay) 0));
+  ((_XPrivDisplay) display)->screens = &screen;
+  ((_XPrivDisplay) display)->nscreens = 1;
+  ((_XPrivDisplay) display)->fd = 0;
+
+  dpy = &fakeOps;
+
+  (void) clock_gettime (CLOCK_MONOTONIC, &start);
+  for (r = 0; r < repeat; ++r) simulate ();
+  (void) clock_gettime (CLOCK_MONOTONIC, &end);
+
+  elapsed =   (end.tv_sec - start.tv_sec)
+            + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+  (void) printf ("%ld day(s) simulated %ld time(s) in %.3f s: "
+                 "%lu locks, %lu unlocks, %lu notifications, "
+                 "%lu round trips (%.1f per minute), "
+                 "%lu iterations (%.0f per second).\n",
+                 days, repeat, elapsed, world.locks, world.unlocks,
+                 world.bells, world.roundTrips,
+                 world.roundTrips / (days * 1440.0),
+                 world.iterations, world.iterations * repeat / elapsed);
+
+  return EXIT_SUCCESS;
+}
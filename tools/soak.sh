@@ -0,0 +1,328 @@
+#!/bin/sh
+#
+#  Soak test for xautolock. Starts a number of Xvfb servers with an
+#  xautolock on each, and has xactivity play a different, random user on
+#  every one of them for hours on end: bursts of activity of up to five
+#  minutes, separated by pauses that are mostly shorter than the lock
+#  time, but now and then longer. Meanwhile, the daemons get sampled
+#  every so many seconds, and one line of JSON per sample is written to
+#  the results file:
+#
+#    label                as given by -label, to tell builds apart
+#    elapsed              seconds since the start
+#    daemons              how many of them are still running
+#    cpu_percent          user + system CPU time of all daemons together,
+#                         as a percentage of one CPU, since the previous
+#                         sample
+#    ctxt_switches_per_second
+#                         voluntary and involuntary ones of all daemons
+#                         together, since the previous sample
+#    rss_kb_total, rss_kb_max
+#                         VmRSS of all daemons together, and of the
+#                         biggest one
+#
+#  At the end, a summary line is added, with "summary":true and the
+#  averages of the above, plus what happened to the lock deadlines:
+#
+#    locks                as it says
+#    late_locks           locks more than -slack seconds after the lock
+#                         deadline
+#    early_locks          locks more than -slack seconds before it
+#    missed_locks         pauses that lasted longer than the lock time
+#                         plus -slack without a lock
+#    lateness_ms          mean, p99 and max of how late the locks were
+#
+#  Usage: soak.sh [-o results] [-sessions n] [-hours h] [-interval secs]
+#                 [-slack secs] [-seed n] [-label text]
+#
+#  Defaults are 10 sessions, 1 hour, a sample every 60 seconds, 2 seconds
+#  of slack and soak-results.jsonl. The xautolock and xactivity binaries
+#  are taken from $XAUTOLOCK and $XACTIVITY, or from the source tree.
+#  Needs Xvfb with the XTEST extension. Every session costs an Xvfb of
+#  a few megabytes, so mind the memory when going into the hundreds.
+#  Same seed, same users, so results of different builds can be compared.
+#
+#  Please send bug reports etc. to mce@scarlet.be.
+#
+
+here=`dirname "$0"`
+XAUTOLOCK=${XAUTOLOCK:-$here/../xautolock}
+XACTIVITY=${XACTIVITY:-$here/xactivity}
+XVFB=${XVFB:-Xvfb}
+
+results=soak-results.jsonl
+sessions=10
+hours=1
+interval=60
+slack=2
+seed=1
+label=
+lockSecs=60
+
+usage ()
+{
+  echo "Usage: $0 [-o results] [-sessions n] [-hours h] [-interval secs]" \
+       "[-slack secs] [-seed n] [-label text]" >&2
+  exit 1
+}
+
+while [ $# -gt 0 ]
+do
+  case "$1" in
+    -o)        results="$2";  shift 2 ;;
+    -sessions) sessions="$2"; shift 2 ;;
+    -hours)    hours="$2";    shift 2 ;;
+    -interval) interval="$2"; shift 2 ;;
+    -slack)    slack="$2";    shift 2 ;;
+    -seed)     seed="$2";     shift 2 ;;
+    -label)    label="$2";    shift 2 ;;
+    *)         usage ;;
+  esac
+done
+
+[ $# -eq 0 ] || usage
+
+for f in "$XAUTOLOCK" "$XACTIVITY"
+do
+  if [ ! -x "$f" ]
+  then
+    echo "$0: $f not found, build it first." >&2
+    exit 1
+  fi
+done
+
+work=`mktemp -d /tmp/xautolock-soak.XXXXXX` || exit 1
+pids=
+daemons=
+
+cleanup ()
+{
+  [ -n "$pids" ] && kill $pids 2>/dev/null
+  rm -rf "$work"
+}
+
+trap cleanup EXIT
+trap 'exit 1' INT TERM
+
+seconds=`awk -v h="$hours" 'BEGIN { printf "%d", h * 3600 }'`
+version=`"$XAUTOLOCK" -version 2>&1 | sed 's/.*version //'`
+ticks=`getconf CLK_TCK`
+
+#
+#  Function for writing the script of one random user, long enough to
+#  last the whole soak.
+#
+makeScript ()
+{
+  awk -v seed="$1" -v seconds="$seconds" -v lockSecs="$lockSecs" '
+    BEGIN {
+      srand (seed)
+
+      for (t = 0; t < seconds * 1000; )
+      {
+        burst = t + 10000 + int (rand () * 290000)
+
+        for (x = rand () * 640; t < burst; t += step)
+        {
+          x = (x + 37) % 640
+          if (rand () < 0.7) print "move", int (x), int (rand () * 480)
+          else               print "key", (rand () < 0.8 ? "a" : "space")
+
+          step = 100 + int (rand () * 1900)
+          print "sleep", step
+        }
+
+        if (rand () < 0.25) pause = lockSecs * 1000 + int (rand () * 600000)
+        else                pause = int (rand () * lockSecs * 900)
+
+        print "sleep", pause
+        t += pause
+      }
+    }'
+}
+
+#
+#  Start the servers, the daemons and the users.
+#
+display=99
+s=0
+
+while [ $s -lt $sessions ]
+do
+  while [ -e /tmp/.X$display-lock ]
+  do
+    display=`expr $display + 1`
+  done
+
+  $XVFB :$display -screen 0 640x480x16 -nolisten tcp \
+        >"$work/xvfb.$s.log" 2>&1 &
+  pids="$pids $!"
+
+  tries=0
+  until DISPLAY=:$display "$XACTIVITY" /dev/null 2>/dev/null
+  do
+    tries=`expr $tries + 1`
+
+    if [ $tries -gt 50 ]
+    then
+      echo "$0: Xvfb :$display didn't come up:" >&2
+      cat "$work/xvfb.$s.log" >&2
+      exit 1
+    fi
+
+    sleep 0.1
+  done
+
+  stamps="$work/$s.stamps"
+  : >"$stamps"
+
+  DISPLAY=:$display "$XAUTOLOCK" -time 1 -id soak -nocloseerr \
+          -locker "$XACTIVITY -o $stamps -stamp locked" \
+          2>"$work/xautolock.$s.log" &
+  daemons="$daemons $!"
+  pids="$pids $!"
+
+  makeScript `expr $seed \* 100000 + $s` >"$work/$s.script"
+  DISPLAY=:$display "$XACTIVITY" -o "$stamps" "$work/$s.script" &
+  pids="$pids $!"
+
+  display=`expr $display + 1`
+  s=`expr $s + 1`
+done
+
+#
+#  Function for adding up what the daemons are using: CPU ticks, context
+#  switches, the number of daemons still alive, total and maximum RSS.
+#
+sample ()
+{
+  for pid in $daemons
+  do
+    [ -r /proc/$pid/stat ] || continue
+    awk '{ print "cpu", $14 + $15 }' /proc/$pid/stat
+    awk '/^VmRSS:/ { print "rss", $2 }
+         /ctxt_switches:/ { print "ctxt", $2 }' /proc/$pid/status
+  done 2>/dev/null | awk '
+    $1 == "cpu"  { cpu += $2; ++alive }
+    $1 == "ctxt" { ctxt += $2 }
+    $1 == "rss"  { rss += $2; if ($2 > max) max = $2 }
+    END          { printf "%d %d %d %d %d\n", cpu, ctxt, alive, rss, max }'
+}
+
+started=`date +%s`
+previous=`sample`
+previousTime=$started
+elapsed=0
+samples=0
+
+while [ $elapsed -lt $seconds ]
+do
+  sleep $interval
+  now=`date +%s`
+  current=`sample`
+  elapsed=`expr $now - $started`
+
+  echo "$previous $previousTime $current $now" | \
+    awk -v label="$label" -v version="$version" -v ticks="$ticks" \
+        -v elapsed="$elapsed" '{
+      span = $12 - $6
+      printf "{\"label\":\"%s\",\"version\":\"%s\",\"elapsed\":%d,", \
+             label, version, elapsed
+      printf "\"daemons\":%d,\"cpu_percent\":%.3f,", \
+             $9, span ? ($7 - $1) / ticks / span * 100 : 0
+      printf "\"ctxt_switches_per_second\":%.2f,", \
+             span ? ($8 - $2) / span : 0
+      printf "\"rss_kb_total\":%d,\"rss_kb_max\":%d}\n", $10, $11
+    }' >>"$results"
+
+  previous=$current
+  previousTime=$now
+  samples=`expr $samples + 1`
+done
+
+#
+#  The summary. Locks are checked against the activity stamps of their
+#  own session; the averages are taken from this run's samples.
+#
+s=0
+
+while [ $s -lt $sessions ]
+do
+  sort -k2 -n "$work/$s.stamps" | \
+    awk -v lockSecs="$lockSecs" -v slack="$slack" '
+    $1 == "activity" {
+      if (last && !locked && $2 - last > lockSecs + slack) print "missed"
+      last = $2
+      locked = 0
+    }
+    $1 == "locked" && last && !locked {
+      late = $2 - last - lockSecs
+      if (late < -slack) print "early"
+      else               print "lock", late * 1000
+      locked = 1
+    }'
+
+  s=`expr $s + 1`
+done >"$work/locks"
+
+tail -n $samples "$results" | \
+  awk -F, -v label="$label" -v version="$version" -v sessions="$sessions" \
+      -v slack="$slack" -v locksFile="$work/locks" '
+    {
+      for (f = 1; f <= NF; ++f)
+      {
+        split ($f, kv, ":")
+        gsub (/[{}"]/, "", kv[1])
+        gsub (/[{}"]/, "", kv[2])
+        sum[kv[1]] += kv[2]
+      }
+      ++samples
+    }
+    END {
+      while ((getline line < locksFile) > 0)
+      {
+        split (line, l, " ")
+        if      (l[1] == "missed") ++missed
+        else if (l[1] == "early")  ++early
+        else
+        {
+          lateness[++locks] = l[2]
+          total += l[2]
+          if (l[2] > slack * 1000) ++late
+        }
+      }
+
+      for (i = 2; i <= locks; ++i)
+      {
+        v = lateness[i]
+        for (j = i - 1; j >= 1 && lateness[j] > v; --j)
+        {
+          lateness[j + 1] = lateness[j]
+        }
+        lateness[j + 1] = v
+      }
+
+      printf "{\"label\":\"%s\",\"version\":\"%s\",\"summary\":true,", \
+             label, version
+      printf "\"sessions\":%d,\"samples\":%d,", sessions, samples
+      n = samples ? samples : 1
+      printf "\"cpu_percent\":%.3f,", sum["cpu_percent"] / n
+      printf "\"ctxt_switches_per_second\":%.2f,", \
+             sum["ctxt_switches_per_second"] / n
+      printf "\"rss_kb_total\":%d,", sum["rss_kb_total"] / n
+      printf "\"locks\":%d,\"late_locks\":%d,", locks + early, late
+      printf "\"early_locks\":%d,\"missed_locks\":%d,", early, missed
+
+      if (locks)
+      {
+        printf "\"lateness_ms\":{\"mean\":%.1f,\"p99\":%.1f,", \
+               total / locks, lateness[int ((locks - 1) * 0.99) + 1]
+        printf "\"max\":%.1f}}\n", lateness[locks]
+      }
+      else
+      {
+        printf "\"lateness_ms\":null}\n"
+      }
+    }' >>"$results"
+
+echo "Results appended to $results."
@@ -0,0 +1,226 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          a little tool that turns a flight recorder dump (see
+ *          src/trace.c) into something humans can read, oldest record
+ *          first.
+ *
+ *          Usage: tracedump file
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "trace.h"
+
+static const char* typeNames[tr_count] =
+  { "none", "lock-trigger", "kill-trigger", "corner", "activity", "spawn",
+    "spawn-failed", "locker-exit", "message", "x-error", "resume",
+    "clock-step", "locked", "freeze", "thaw", "demote", "restore",
+    "reclaim", "pressure", "stagger", "prespawn" };
+
+static const char* commandNames[] =
+  { "locker", "nowlocker", "notifier", "killer", "authhelper" };
+
+static const char* messageNames[] =
+  { "unknown", "disable", "enable", "toggle", "exit", "locknow",
+    "unlocknow", "restart", "isdisabled", "dumptrace", "locklatency" };
+
+static const char* lockKindNames[] =
+  { "locker", "nowlocker", "builtin" };
+
+static const char* pressureNames[] =
+  { "none", "some", "full" };
+
+static const char* prespawnNames[] =
+  { "started", "ready", "used", "cancelled" };
+
+static const char* responseNames[] =
+  { "none", "success", "failure", "bool", "latency" };
+
+#define nameOf(table,i) \
+  ((i) >= 0 && (i) < (long long) (sizeof (table) / sizeof (table[0])) \
+   ? table[i] : "?")
+
+/*
+ *  Function for printing the arguments of a record in a way that
+ *  suits its type.
+ */
+static void
+printArgs (const traceRecord* r)
+{
+  switch (r->type)
+  {
+    case tr_lockTrigger:
+      (void) printf ("in %llds", r->arg1);
+      break;
+
+    case tr_killTrigger:
+      if (r->arg1 < 0) (void) printf ("off");
+      else             (void) printf ("in %llds", r->arg1);
+      break;
+
+    case tr_corner:
+      (void) printf ("in %llds%s", r->arg1, r->arg2 ? " (redelay)" : "");
+      break;
+
+    case tr_spawn:
+      (void) printf ("%s pid %lld", nameOf (commandNames, r->arg1), r->arg2);
+      break;
+
+    case tr_spawnFailed:
+      (void) printf ("%s: %s", nameOf (commandNames, r->arg1),
+                     r->arg2 ? strerror ((int) r->arg2) : "exec failed");
+      break;
+
+    case tr_lockerExit:
+      if (r->arg1) (void) printf ("pid %lld ", r->arg1);
+      else         (void) printf ("built-in ");
+      if (r->arg2 < 0) (void) printf ("crashed");
+      else             (void) printf ("status %lld", r->arg2);
+      break;
+
+    case tr_message:
+      (void) printf ("%s -> %s", nameOf (messageNames, r->arg1),
+                     nameOf (responseNames, r->arg2));
+      break;
+
+    case tr_xError:
+      (void) printf ("error %lld, request %lld", r->arg1, r->arg2);
+      break;
+
+    case tr_locked:
+      (void) printf ("%s, %lld ms after the deadline",
+                     nameOf (lockKindNames, r->arg1), r->arg2);
+      break;
+
+    case tr_freeze:
+      if (r->arg1 < 0) (void) printf ("cgroup");
+      else             (void) printf ("%lld processes", r->arg1);
+      if (r->arg2 < 0) (void) printf (", unconfirmed");
+      else             (void) printf (", %lld us", r->arg2);
+      break;
+
+    case tr_thaw:
+      (void) printf ("after %lld.%03llds", r->arg1 / 1000, r->arg1 % 1000);
+      if (r->arg2 < 0) (void) printf (", unconfirmed");
+      else             (void) printf (", %lld us", r->arg2);
+      break;
+
+    case tr_demote:
+      (void) printf ("%lld processes, %lld us", r->arg1, r->arg2);
+      break;
+
+    case tr_restore:
+      (void) printf ("%lld processes", r->arg1);
+      if (r->arg2 < 0) (void) printf (", incomplete");
+      else             (void) printf (", %lld us", r->arg2);
+      break;
+
+    case tr_reclaim:
+      (void) printf ("%lld pages", r->arg1);
+      if (r->arg2 < 0) (void) printf (", cut short");
+      else             (void) printf (", %lld ms", r->arg2);
+      break;
+
+    case tr_pressure:
+      (void) printf ("%s, kill after %lld min",
+                     nameOf (pressureNames, r->arg1), r->arg2 / 60);
+      break;
+
+    case tr_stagger:
+      (void) printf ("%lld launches, for %lld ms", r->arg1, r->arg2);
+      break;
+
+    case tr_prespawn:
+      (void) printf ("%s, pid %lld", nameOf (prespawnNames, r->arg1), r->arg2);
+      break;
+
+    case tr_resume:
+      (void) printf ("after %lld.%03llds", r->arg1 / 1000, r->arg1 % 1000);
+      break;
+
+    default:
+      break;
+  }
+}
+
+int
+main (int argc, char* argv[])
+{
+  traceHeader  header;     /* as it says                 */
+  traceRecord* records;    /* as it says                 */
+  FILE*        file;       /* as it says                 */
+  long long    first;      /* oldest record still there  */
+  long long    i;          /* loop counter               */
+
+  if (argc != 2)
+  {
+    (void) fprintf (stderr, "Usage : %s file\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (!(file = fopen (argv[1], "rb"))) /* = intended */
+  {
+    perror (argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  if (   fread (&header, sizeof (header), 1, file) != 1
+      || memcmp (header.magic, TRACE_MAGIC, sizeof (header.magic))
+      || header.version != TRACE_VERSION
+      || header.recordSize != sizeof (traceRecord)
+      || header.nofRecords <= 0)
+  {
+    (void) fprintf (stderr, "%s: not a trace dump I understand.\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  records = (traceRecord*) calloc (header.nofRecords, sizeof (traceRecord));
+
+  if (   !records
+      || fread (records, sizeof (traceRecord), header.nofRecords, file)
+         != (size_t) header.nofRecords)
+  {
+    (void) fprintf (stderr, "%s: truncated.\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  (void) fclose (file);
+  (void) printf ("pid %lld, %lld records written, last %d kept.\n",
+                 header.pid, header.next, header.nofRecords);
+
+  first = header.next > header.nofRecords ? header.next - header.nofRecords
+                                          : 0;
+
+  for (i = first; i < header.next; ++i)
+  {
+    const traceRecord* r = &records[i % header.nofRecords];
+    long long          ago = header.stamp - r->stamp;
+    time_t             when = header.wallClock - ago / 1000000000;
+    char               stamp[32];
+
+    (void) strftime (stamp, sizeof (stamp), "%Y-%m-%d %H:%M:%S",
+                     localtime (&when));
+    (void) printf ("%s %10lld.%03llds ago  %-13s ", stamp,
+                   ago / 1000000000, ago % 1000000000 / 1000000,
+                   nameOf (typeNames, r->type));
+    printArgs (r);
+    if (r->repeats) (void) printf (" (x%d)", r->repeats + 1);
+    (void) printf ("\n");
+  }
+
+  free (records);
+  return EXIT_SUCCESS;
+}
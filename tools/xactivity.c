@@ -0,0 +1,413 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          a little tool that fakes user activity by means of the XTest
+ *          extension, so that xautolock can be benchmarked on a virtual
+ *          server such as Xvfb. See bench.sh.
+ *
+ *          Usage: xactivity [-o file] [-repeat n] [script]
+ *                 xactivity [-o file] -stamp label
+ *                 xactivity [-o file] -record secs
+ *
+ *          The first form replays the script (stdin if not given) n
+ *          times. The second one just writes a time stamp, and is meant
+ *          to be used as the -locker. The third one watches what the
+ *          user does for secs seconds, and writes it out as a script,
+ *          so that a real user can be replayed against every backend.
+ *          Scripts consist of lines reading
+ *
+ *            move x y      move the pointer to (x, y)
+ *            key keysym    press and release a key
+ *            button n      press and release a pointer button
+ *            sleep ms      wait for ms milliseconds
+ *            stamp label   write a time stamp
+ *
+ *          Empty lines and lines starting with `#' are ignored. Every
+ *          event gets stamped as "activity" once the server has seen it.
+ *          Stamps read "label seconds", with seconds on the CLOCK_MONOTONIC
+ *          clock, which is what xautolock uses as well. Sleeps are
+ *          measured from the end of the previous sleep, so that the time
+ *          it takes to send the events doesn't add up.
+ *
+ *          Recording is done by polling the pointer and the keyboard
+ *          every RECORD_TICK milliseconds, so it takes neither the
+ *          RECORD extension nor a grab. Anything shorter than a tick
+ *          may get lost, and modifiers end up as separate key strokes,
+ *          but that's close enough for an idle detector.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "config.h"
+
+#include <errno.h>
+#include <X11/extensions/XTest.h>
+#include <X11/XKBlib.h>
+
+#define RECORD_TICK 20 /* milliseconds between two looks at the user */
+
+typedef enum
+{
+  sc_move,    /* as it says */
+  sc_key,     /* as it says */
+  sc_button,  /* as it says */
+  sc_sleep,   /* as it says */
+  sc_stamp    /* as it says */
+} stepType;
+
+typedef struct
+{
+  stepType type;      /* as it says                     */
+  long     arg1;      /* coordinate, keycode, button or
+                         milliseconds                   */
+  long     arg2;      /* coordinate                     */
+  char     label[32]; /* for sc_stamp                   */
+} step;
+
+static FILE* out; /* where the stamps go */
+
+/*
+ *  Function for writing a time stamp.
+ */
+static void
+stamp (const char* label)
+{
+  struct timespec now;
+
+  (void) clock_gettime (CLOCK_MONOTONIC, &now);
+  (void) fprintf (out, "%s %ld.%09ld\n", label, (long) now.tv_sec,
+                  now.tv_nsec);
+}
+
+/*
+ *  Function for reading a script. Returns the number of steps read,
+ *  or -1 if something is wrong with it.
+ */
+static int
+readScript (Display* d, FILE* file, step** steps)
+{
+  char  line[256];    /* as it says   */
+  char  word[32];     /* as it says   */
+  char  name[32];     /* as it says   */
+  int   nofSteps = 0; /* as it says   */
+  int   size = 64;    /* as it says   */
+  int   lineNr = 0;   /* as it says   */
+  step* s;            /* current step */
+
+  *steps = (step*) malloc (size * sizeof (step));
+
+  while (*steps && fgets (line, sizeof (line), file))
+  {
+    ++lineNr;
+    if (sscanf (line, "%31s", word) != 1 || *word == '#') continue;
+
+    if (nofSteps == size)
+    {
+      *steps = (step*) realloc (*steps, (size *= 2) * sizeof (step));
+      if (!*steps) break;
+    }
+
+    s = &(*steps)[nofSteps++];
+    s->arg1 = s->arg2 = 0;
+
+    if (!strcmp (word, "move"))
+    {
+      s->type = sc_move;
+      if (sscanf (line, "%*s %ld %ld", &s->arg1, &s->arg2) == 2) continue;
+    }
+    else if (!strcmp (word, "key"))
+    {
+      s->type = sc_key;
+
+      if (   sscanf (line, "%*s %31s", name) == 1
+          && (s->arg1 = XKeysymToKeycode (d, XStringToKeysym (name))))
+      {
+        continue;
+      }
+    }
+    else if (!strcmp (word, "button"))
+    {
+      s->type = sc_button;
+      if (sscanf (line, "%*s %ld", &s->arg1) == 1 && s->arg1 > 0) continue;
+    }
+    else if (!strcmp (word, "sleep"))
+    {
+      s->type = sc_sleep;
+      if (sscanf (line, "%*s %ld", &s->arg1) == 1 && s->arg1 >= 0) continue;
+    }
+    else if (!strcmp (word, "stamp"))
+    {
+      s->type = sc_stamp;
+      if (sscanf (line, "%*s %31s", s->label) == 1) continue;
+    }
+
+    (void) fprintf (stderr, "Line %d: can't make sense of %s", lineNr, line);
+    return -1;
+  }
+
+  if (!*steps)
+  {
+    (void) fprintf (stderr, "Out of memory.\n");
+    return -1;
+  }
+
+  return nofSteps;
+}
+
+/*
+ *  Function for replaying a script.
+ */
+static void
+replay (Display* d, const step* steps, int nofSteps)
+{
+  static struct timespec wakeup = { 0, 0 }; /* end of the previous sleep */
+  int                    i;                 /* loop counter              */
+
+  if (!wakeup.tv_sec) (void) clock_gettime (CLOCK_MONOTONIC, &wakeup);
+
+  for (i = -1; ++i < nofSteps; )
+  {
+    const step* s = &steps[i];
+
+    switch (s->type)
+    {
+      case sc_move:
+        (void) XTestFakeMotionEvent (d, -1, (int) s->arg1, (int) s->arg2,
+                                     CurrentTime);
+        break;
+
+      case sc_key:
+        (void) XTestFakeKeyEvent (d, (unsigned) s->arg1, True, CurrentTime);
+        (void) XTestFakeKeyEvent (d, (unsigned) s->arg1, False, CurrentTime);
+        break;
+
+      case sc_button:
+        (void) XTestFakeButtonEvent (d, (unsigned) s->arg1, True,
+                                     CurrentTime);
+        (void) XTestFakeButtonEvent (d, (unsigned) s->arg1, False,
+                                     CurrentTime);
+        break;
+
+      case sc_sleep:
+        wakeup.tv_sec += s->arg1 / 1000;
+        wakeup.tv_nsec += s->arg1 % 1000 * 1000000;
+
+        if (wakeup.tv_nsec >= 1000000000)
+        {
+          ++wakeup.tv_sec;
+          wakeup.tv_nsec -= 1000000000;
+        }
+
+        while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, 0))
+        {
+          if (errno != EINTR) break;
+        }
+        continue;
+
+      case sc_stamp:
+        stamp (s->label);
+        continue;
+    }
+
+    (void) XSync (d, False);
+    stamp ("activity");
+  }
+
+  (void) fflush (out);
+}
+
+/*
+ *  Function for recording what the user does.
+ */
+static void
+record (Display* d, long seconds)
+{
+  static const unsigned buttonMasks[] =
+    { Button1Mask, Button2Mask, Button3Mask, Button4Mask, Button5Mask };
+  struct timespec wakeup;             /* as it says                */
+  char            keys[32];           /* keyboard state            */
+  char            oldKeys[32];        /* same, one tick ago        */
+  Window          root, child;        /* dummies                   */
+  int             x, y, oldX, oldY;   /* pointer position          */
+  int             dummy;              /* as it says                */
+  unsigned        mask, oldMask;      /* button state              */
+  long            idle = 0;           /* ms since the last event   */
+  long            tick;               /* loop counter              */
+  int             k;                  /* loop counter              */
+  int             b;                  /* loop counter              */
+
+  (void) XQueryPointer (d, DefaultRootWindow (d), &root, &child,
+                        &oldX, &oldY, &dummy, &dummy, &oldMask);
+  (void) XQueryKeymap (d, oldKeys);
+  (void) clock_gettime (CLOCK_MONOTONIC, &wakeup);
+
+  for (tick = 0; tick < seconds * 1000 / RECORD_TICK; ++tick)
+  {
+    wakeup.tv_nsec += RECORD_TICK * 1000000;
+
+    if (wakeup.tv_nsec >= 1000000000)
+    {
+      ++wakeup.tv_sec;
+      wakeup.tv_nsec -= 1000000000;
+    }
+
+    while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, 0))
+    {
+      if (errno != EINTR) break;
+    }
+
+    idle += RECORD_TICK;
+
+    (void) XQueryPointer (d, DefaultRootWindow (d), &root, &child,
+                          &x, &y, &dummy, &dummy, &mask);
+    (void) XQueryKeymap (d, keys);
+
+    if (x != oldX || y != oldY)
+    {
+      (void) fprintf (out, "sleep %ld\nmove %d %d\n", idle, x, y);
+      idle = 0;
+      oldX = x;
+      oldY = y;
+    }
+
+    for (b = -1; ++b < (int) (sizeof (buttonMasks) / sizeof (unsigned)); )
+    {
+      if ((mask & buttonMasks[b]) && !(oldMask & buttonMasks[b]))
+      {
+        (void) fprintf (out, "sleep %ld\nbutton %d\n", idle, b + 1);
+        idle = 0;
+      }
+    }
+
+    for (k = 8; k < 256; ++k)
+    {
+      if ((keys[k / 8] & (1 << (k % 8))) && !(oldKeys[k / 8] & (1 << (k % 8))))
+      {
+        KeySym      keysym = XkbKeycodeToKeysym (d, (KeyCode) k, 0, 0);
+        const char* name = keysym ? XKeysymToString (keysym) : 0;
+
+        if (name)
+        {
+          (void) fprintf (out, "sleep %ld\nkey %s\n", idle, name);
+          idle = 0;
+        }
+      }
+    }
+
+    oldMask = mask;
+    (void) memcpy (oldKeys, keys, sizeof (keys));
+  }
+
+  (void) fprintf (out, "sleep %ld\n", idle);
+  (void) fflush (out);
+}
+
+static void
+usage (const char* progName)
+{
+  (void) fprintf (stderr, "Usage : %s [-o file] [-repeat n] [script]\n"
+                          "        %s [-o file] -stamp label\n"
+                          "        %s [-o file] -record secs\n",
+                  progName, progName, progName);
+  exit (EXIT_FAILURE);
+}
+
+int
+main (int argc, char* argv[])
+{
+  Display*    d;              /* as it says        */
+  FILE*       script = stdin; /* as it says        */
+  step*       steps;          /* the parsed script */
+  int         nofSteps;       /* as it says        */
+  long        repeat = 1;     /* as it says        */
+  const char* label = 0;      /* for -stamp        */
+  long        seconds = 0;    /* for -record       */
+  int         dummy;          /* as it says        */
+  int         a;              /* loop counter      */
+
+  out = stdout;
+
+  for (a = 0; ++a < argc && *argv[a] == '-'; )
+  {
+    if (!strcmp (argv[a], "-o") && a + 1 < argc)
+    {
+      if (!(out = fopen (argv[++a], "a"))) /* = intended */
+      {
+        perror (argv[a]);
+        return EXIT_FAILURE;
+      }
+    }
+    else if (!strcmp (argv[a], "-repeat") && a + 1 < argc)
+    {
+      repeat = atol (argv[++a]);
+    }
+    else if (!strcmp (argv[a], "-stamp") && a + 1 < argc)
+    {
+      label = argv[++a];
+    }
+    else if (!strcmp (argv[a], "-record") && a + 1 < argc)
+    {
+      if ((seconds = atol (argv[++a])) <= 0) usage (argv[0]);
+    }
+    else
+    {
+      usage (argv[0]);
+    }
+  }
+
+  if (label)
+  {
+    if (a != argc) usage (argv[0]);
+    stamp (label);
+    return EXIT_SUCCESS;
+  }
+
+  if (a < argc - 1 || (seconds && a != argc)) usage (argv[0]);
+
+  if (a < argc && !(script = fopen (argv[a], "r"))) /* = intended */
+  {
+    perror (argv[a]);
+    return EXIT_FAILURE;
+  }
+
+  if (!(d = XOpenDisplay (0))) /* = intended */
+  {
+    (void) fprintf (stderr, "Couldn't connect to %s\n", XDisplayName (0));
+    return EXIT_FAILURE;
+  }
+
+  if (seconds)
+  {
+    record (d, seconds);
+    (void) XCloseDisplay (d);
+    return EXIT_SUCCESS;
+  }
+
+  if (!XTestQueryExtension (d, &dummy, &dummy, &dummy, &dummy))
+  {
+    (void) fprintf (stderr, "%s has no XTest extension.\n", XDisplayName (0));
+    return EXIT_FAILURE;
+  }
+
+  if ((nofSteps = readScript (d, script, &steps)) < 0) /* = intended */
+  {
+    return EXIT_FAILURE;
+  }
+
+  while (repeat-- > 0) replay (d, steps, nofSteps);
+
+  (void) XCloseDisplay (d);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,456 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          a little proxy that sits between X clients and a local server,
+ *          such as Xvfb, and delays everything going either way, so as to
+ *          find out how xautolock would fare on a remote display.
+ *
+ *          Usage: xlagproxy [-display :n] [-listen :m] [-latency ms]
+ *                           [-jitter ms] [-seed n] [-bound n]
+ *
+ *          Clients connect to display :m (:n + 1 by default), and get
+ *          forwarded to display :n ($DISPLAY by default). Only local
+ *          displays are supported, and no authorisation is done, so
+ *          start the server without one. Every chunk of data gets held
+ *          back for -latency milliseconds one way, plus a random extra
+ *          of up to -jitter milliseconds, but never overtakes the one
+ *          before it.
+ *
+ *          Every minute, a line reading "minute n connections round_trips
+ *          bytes_up bytes_down" is printed, connections being the number
+ *          of them open at the time. A round trip is a reply (or
+ *          an error) answering something the client sent since the
+ *          previous one, i.e. something the client will have waited for.
+ *          That's how Xlib works; events don't count. When killed, the
+ *          largest number of round trips in any minute is printed, and
+ *          with -bound, the exit status tells whether it stayed within n.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "config.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define SOCKET_DIR  "/tmp/.X11-unix"
+#define MAX_CLIENTS 64    /* as it says              */
+#define CHUNK       65536 /* most we read in one go  */
+
+typedef struct chunk
+{
+  long          due;     /* when to pass it on      */
+  size_t        length;  /* as it says              */
+  size_t        done;    /* how much already went   */
+  struct chunk* next;    /* as it says              */
+  char          data[1]; /* as it says              */
+} chunk;
+
+typedef struct
+{
+  int    fd;      /* where this direction writes to  */
+  chunk* head;    /* oldest data in flight           */
+  chunk* tail;    /* newest ...                      */
+  long   bytes;   /* passed on this minute           */
+} direction;
+
+typedef struct
+{
+  int       client;    /* as it says, -1 if unused              */
+  int       server;    /* as it says                            */
+  direction up;        /* client to server                      */
+  direction down;      /* server to client                      */
+  Bool      asked;     /* client sent something since the last
+                          reply                                 */
+} connection;
+
+static connection            clients[MAX_CLIENTS];
+static long                  latency = 50;    /* -latency                 */
+static long                  jitter = 0;      /* -jitter                  */
+static volatile sig_atomic_t done = 0;        /* set when killed          */
+
+static long
+milliNow (void)
+{
+  struct timespec now;
+
+  (void) clock_gettime (CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static void
+stop (int sig)
+{
+  done = 1;
+}
+
+/*
+ *  Functions for getting at the UNIX socket of a display.
+ */
+static int
+displayNumber (const char* name)
+{
+  const char* colon;  /* as it says */
+  char        c;      /* dummy      */
+  int         n;      /* as it says */
+
+  if (   !name
+      || !(colon = strrchr (name, ':'))
+      || (colon != name && strncmp (name, "unix:", 5))
+      || sscanf (colon + 1, "%d%c", &n, &c) < 1)
+  {
+    return -1;
+  }
+
+  return n;
+}
+
+static void
+socketAddress (int display, struct sockaddr_un* address)
+{
+  (void) memset (address, 0, sizeof (*address));
+  address->sun_family = AF_UNIX;
+  (void) snprintf (address->sun_path, sizeof (address->sun_path),
+                   SOCKET_DIR "/X%d", display);
+}
+
+/*
+ *  Function for queueing what was just read.
+ */
+static void
+enqueue (direction* dir, const char* data, size_t length)
+{
+  chunk* c = (chunk*) malloc (sizeof (chunk) + length);
+  long   due = milliNow () + latency + (jitter ? rand () % (jitter + 1) : 0);
+
+  if (!c)
+  {
+    (void) fprintf (stderr, "Out of memory.\n");
+    exit (EXIT_FAILURE);
+  }
+
+  if (dir->tail && dir->tail->due > due) due = dir->tail->due;
+
+  c->due = due;
+  c->length = length;
+  c->done = 0;
+  c->next = 0;
+  (void) memcpy (c->data, data, length);
+
+  if (dir->tail) dir->tail->next = c;
+  else           dir->head = c;
+  dir->tail = c;
+}
+
+/*
+ *  Function for passing on whatever is due. Returns False if the
+ *  receiving end is gone.
+ */
+static Bool
+deliver (direction* dir, long now, connection* conn, long* roundTrips)
+{
+  chunk*  c;     /* as it says */
+  ssize_t sent;  /* as it says */
+
+  while ((c = dir->head) && c->due <= now) /* = intended */
+  {
+    if (   dir == &conn->down
+        && !c->done
+        && conn->asked
+        && (c->data[0] == 0 || c->data[0] == 1))
+    {
+      ++*roundTrips;
+      conn->asked = False;
+    }
+
+    sent = send (dir->fd, c->data + c->done, c->length - c->done,
+                 MSG_NOSIGNAL | MSG_DONTWAIT);
+
+    if (sent < 0)
+    {
+      return errno == EAGAIN || errno == EINTR;
+    }
+
+    dir->bytes += sent;
+    if ((c->done += sent) < c->length) return True;
+
+    dir->head = c->next;
+    if (!dir->head) dir->tail = 0;
+    free (c);
+  }
+
+  return True;
+}
+
+static void
+closeConnection (connection* conn)
+{
+  direction* dirs[2]; /* as it says   */
+  int        i;       /* loop counter */
+
+  dirs[0] = &conn->up;
+  dirs[1] = &conn->down;
+
+  for (i = -1; ++i < 2; )
+  {
+    while (dirs[i]->head)
+    {
+      chunk* next = dirs[i]->head->next;
+
+      free (dirs[i]->head);
+      dirs[i]->head = next;
+    }
+
+    dirs[i]->tail = 0;
+  }
+
+  (void) close (conn->client);
+  (void) close (conn->server);
+  conn->client = -1;
+}
+
+static void
+usage (const char* progName)
+{
+  (void) fprintf (stderr,
+                  "Usage : %s [-display :n] [-listen :m] [-latency ms]\n"
+                  "        [-jitter ms] [-seed n] [-bound n]\n", progName);
+  exit (EXIT_FAILURE);
+}
+
+int
+main (int argc, char* argv[])
+{
+  struct sockaddr_un address;                 /* as it says               */
+  struct pollfd      fds[1 + 2 * MAX_CLIENTS];/* as it says               */
+  connection*        owners[1 + 2 * MAX_CLIENTS];
+                                              /* connection per fd        */
+  const char*        upstream = getenv ("DISPLAY");
+                                              /* -display                 */
+  int                server;                  /* display number of it     */
+  int                listenOn = -1;           /* -listen                  */
+  long               bound = -1;              /* -bound                   */
+  int                listener;                /* as it says               */
+  long               minuteStart;             /* as it says               */
+  long               minute = 0;              /* as it says               */
+  long               roundTrips = 0;          /* this minute              */
+  long               maxRoundTrips = 0;       /* in any minute            */
+  char               buffer[CHUNK];           /* as it says               */
+  struct sigaction   action;                  /* as it says               */
+  int                a;                       /* loop counter             */
+  int                c;                       /* loop counter             */
+
+  for (a = 0; ++a < argc; )
+  {
+    if      (a + 1 >= argc)                           usage (argv[0]);
+    else if (!strcmp (argv[a], "-display")) upstream = argv[++a];
+    else if (!strcmp (argv[a], "-listen"))
+    {
+      if ((listenOn = displayNumber (argv[++a])) < 0) usage (argv[0]);
+    }
+    else if (!strcmp (argv[a], "-latency")) latency = atol (argv[++a]);
+    else if (!strcmp (argv[a], "-jitter"))  jitter = atol (argv[++a]);
+    else if (!strcmp (argv[a], "-seed"))    srand (atoi (argv[++a]));
+    else if (!strcmp (argv[a], "-bound"))   bound = atol (argv[++a]);
+    else                                              usage (argv[0]);
+  }
+
+  if ((server = displayNumber (upstream)) < 0) /* = intended */
+  {
+    (void) fprintf (stderr, "Need a local display to forward to.\n");
+    usage (argv[0]);
+  }
+
+  if (listenOn < 0) listenOn = server + 1;
+  if (latency < 0 || jitter < 0 || listenOn == server) usage (argv[0]);
+
+ /*
+  *  Claim our display. Leave alone whatever is there already.
+  */
+  socketAddress (listenOn, &address);
+
+  if (   (listener = socket (AF_UNIX, SOCK_STREAM, 0)) < 0
+      || bind (listener, (struct sockaddr*) &address, sizeof (address))
+      || listen (listener, 16))
+  {
+    perror (address.sun_path);
+    return EXIT_FAILURE;
+  }
+
+  action.sa_handler = stop;
+  action.sa_flags = 0;
+  (void) sigemptyset (&action.sa_mask);
+  (void) sigaction (SIGINT, &action, 0);
+  (void) sigaction (SIGTERM, &action, 0);
+
+  for (c = -1; ++c < MAX_CLIENTS; ) clients[c].client = -1;
+
+  (void) printf ("# minute connections round_trips bytes_up bytes_down\n");
+  (void) fflush (stdout);
+  minuteStart = milliNow ();
+
+  while (!done)
+  {
+    long now = milliNow ();
+    long next = minuteStart + 60000; /* next thing to do */
+    int  nfds = 1;                   /* as it says       */
+    int  f;                          /* loop counter     */
+
+   /*
+    *  Pass on whatever is due, and find out when the next thing is.
+    */
+    for (c = -1; ++c < MAX_CLIENTS; )
+    {
+      connection* conn = &clients[c];
+
+      if (conn->client < 0) continue;
+
+      if (   !deliver (&conn->up, now, conn, &roundTrips)
+          || !deliver (&conn->down, now, conn, &roundTrips))
+      {
+        closeConnection (conn);
+        continue;
+      }
+
+      if (conn->up.head && conn->up.head->due < next)
+      {
+        next = conn->up.head->due;
+      }
+
+      if (conn->down.head && conn->down.head->due < next)
+      {
+        next = conn->down.head->due;
+      }
+
+      fds[nfds].fd = conn->client;
+      fds[nfds].events = POLLIN;
+      owners[nfds++] = conn;
+      fds[nfds].fd = conn->server;
+      fds[nfds].events = POLLIN;
+      owners[nfds++] = conn;
+    }
+
+    if (now >= minuteStart + 60000)
+    {
+      long up = 0, down = 0; /* as it says */
+      int  open = 0;         /* as it says */
+
+      for (c = -1; ++c < MAX_CLIENTS; )
+      {
+        up += clients[c].up.bytes;
+        down += clients[c].down.bytes;
+        clients[c].up.bytes = clients[c].down.bytes = 0;
+        if (clients[c].client >= 0) ++open;
+      }
+
+      (void) printf ("minute %ld %d %ld %ld %ld\n", ++minute, open,
+                     roundTrips, up, down);
+      (void) fflush (stdout);
+
+      if (roundTrips > maxRoundTrips) maxRoundTrips = roundTrips;
+      roundTrips = 0;
+      minuteStart += 60000;
+      continue;
+    }
+
+    fds[0].fd = listener;
+    fds[0].events = POLLIN;
+
+    if (poll (fds, nfds, next > now ? (int) (next - now) : 0) <= 0) continue;
+
+   /*
+    *  New clients get a connection of their own to the server.
+    */
+    if (fds[0].revents & POLLIN)
+    {
+      int fd = accept (listener, 0, 0);
+
+      for (c = -1; fd >= 0 && ++c < MAX_CLIENTS && clients[c].client >= 0; );
+
+      if (fd >= 0 && c < MAX_CLIENTS)
+      {
+        struct sockaddr_un target;  /* as it says */
+        connection*        conn = &clients[c];
+
+        socketAddress (server, &target);
+        (void) memset (conn, 0, sizeof (*conn));
+
+        if (   (conn->server = socket (AF_UNIX, SOCK_STREAM, 0)) >= 0
+            && !connect (conn->server, (struct sockaddr*) &target,
+                         sizeof (target)))
+        {
+          conn->client = fd;
+          conn->up.fd = conn->server;
+          conn->down.fd = conn->client;
+        }
+        else
+        {
+          if (conn->server >= 0) (void) close (conn->server);
+          (void) close (fd);
+          conn->client = -1;
+        }
+      }
+      else if (fd >= 0)
+      {
+        (void) close (fd);
+      }
+    }
+
+   /*
+    *  Queue whatever came in. Owners are in pairs, client first.
+    */
+    for (f = 0; ++f < nfds; )
+    {
+      connection* conn = owners[f];
+      Bool        up = f % 2 == 1;
+      ssize_t     got;
+
+      if (!(fds[f].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+      if (conn->client < 0) continue;
+
+      if ((got = recv (fds[f].fd, buffer, sizeof (buffer), 0)) <= 0)
+      {
+        if (got < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        closeConnection (conn);
+        continue;
+      }
+
+      if (up)
+      {
+        enqueue (&conn->up, buffer, got);
+        conn->asked = True;
+      }
+      else
+      {
+        enqueue (&conn->down, buffer, got);
+      }
+    }
+  }
+
+  (void) unlink (address.sun_path);
+
+  if (roundTrips > maxRoundTrips) maxRoundTrips = roundTrips;
+  (void) printf ("max_round_trips_per_minute %ld\n", maxRoundTrips);
+
+  if (bound >= 0 && maxRoundTrips > bound)
+  {
+    (void) printf ("bound of %ld exceeded\n", bound);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
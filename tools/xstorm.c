@@ -0,0 +1,366 @@
+/*****************************************************************************
+ *
+ * Authors: Michel Eyckmans (MCE) & Stefan De Troch (SDT)
+ *
+ * Content: This file is part of version 2.x of xautolock. It implements
+ *          a little tool that puts DIY mode under stress by creating
+ *          lots of windows, and reports how xautolock copes.
+ *
+ *          Usage: xstorm [-depth n] [-width n] [-rate n] [-seconds n]
+ *                        [-lifetime ms] [-masks] [-seed n]
+ *                        [-metrics socket] [-catchup secs]
+ *
+ *          First builds a tree of windows -depth levels deep, with
+ *          -width children per window. Then creates -rate transient
+ *          windows per second for -seconds seconds, each living for
+ *          -lifetime milliseconds, as children of randomly picked tree
+ *          windows. With -masks, every window gets a random event mask
+ *          and do_not_propagate_mask, so that xautolock can't take the
+ *          cheap way out.
+ *
+ *          If given the socket xautolock serves its -metrics on, the
+ *          number of X requests and round trips xautolock needed, the
+ *          deepest its window queue got, and the time it took to work
+ *          through that queue after the storm are reported as well.
+ *          Windows wait CREATION_DELAY seconds in that queue, so the
+ *          latter can't be less than that.
+ *
+ *          Please send bug reports etc. to mce@scarlet.be.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Copyright 1990, 1992-1999, 2001-2002, 2004, 2007 by  Stefan De Troch and
+ * Michel Eyckmans.
+ *
+ * Versions 2.0 and above of xautolock are available under version 2 of the
+ * GNU GPL. Earlier versions are available under other conditions. For more
+ * information, see the License file.
+ *
+ *****************************************************************************/
+
+#include "config.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define TICK 10 /* milliseconds between two batches of windows */
+
+typedef struct
+{
+  double requests;   /* xautolock_x_requests_total{source="diy"}    */
+  double roundTrips; /* xautolock_x_round_trips_total{source="diy"} */
+  double queueDepth; /* xautolock_diy_queue_depth                   */
+} daemonStats;
+
+static Display*    d;                /* as it says                       */
+static Window*     tree = 0;         /* all windows of the tree          */
+static int         treeSize = 0;     /* as it says                       */
+static Bool        randomMasks = False;
+                                     /* whether to use -masks            */
+static const char* metricsPath = 0;  /* xautolock's -metrics socket      */
+
+static long
+milliNow (void)
+{
+  struct timespec now;
+
+  (void) clock_gettime (CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/*
+ *  Function for fetching xautolock's metrics. Returns False if that
+ *  doesn't work out.
+ */
+static Bool
+getStats (daemonStats* stats)
+{
+  struct sockaddr_un address;     /* as it says */
+  static char        page[32768]; /* as it says */
+  size_t             length = 0;  /* as it says */
+  ssize_t            got;         /* as it says */
+  char*              line;        /* as it says */
+  int                fd;          /* as it says */
+
+  if (!metricsPath) return False;
+
+  (void) memset (&address, 0, sizeof (address));
+  address.sun_family = AF_UNIX;
+  (void) strncpy (address.sun_path, metricsPath,
+                  sizeof (address.sun_path) - 1);
+
+  if ((fd = socket (AF_UNIX, SOCK_STREAM, 0)) < 0) /* = intended */
+  {
+    return False;
+  }
+
+  if (connect (fd, (struct sockaddr*) &address, sizeof (address)))
+  {
+    (void) close (fd);
+    return False;
+  }
+
+  while (   length < sizeof (page) - 1
+         && (got = read (fd, page + length, sizeof (page) - 1 - length)) > 0)
+  {
+    length += got;
+  }
+
+  (void) close (fd);
+  page[length] = '\0';
+
+  stats->requests = stats->roundTrips = stats->queueDepth = -1;
+
+  for (line = strtok (page, "\n"); line; line = strtok ((char*) 0, "\n"))
+  {
+    (void) sscanf (line, "xautolock_x_requests_total{source=\"diy\"} %lf",
+                   &stats->requests);
+    (void) sscanf (line, "xautolock_x_round_trips_total{source=\"diy\"} %lf",
+                   &stats->roundTrips);
+    (void) sscanf (line, "xautolock_diy_queue_depth %lf",
+                   &stats->queueDepth);
+  }
+
+  return stats->requests >= 0 && stats->queueDepth >= 0;
+}
+
+/*
+ *  Function for creating a window, with random masks if so desired.
+ */
+static Window
+createWindow (Window parent)
+{
+  static const long inputMasks[] =
+    { KeyPressMask, ButtonPressMask, PointerMotionMask, ExposureMask,
+      StructureNotifyMask };
+  XSetWindowAttributes attribs;    /* as it says   */
+  unsigned long        which = 0;  /* as it says   */
+  Window               window;     /* as it says   */
+  int                  m;          /* loop counter */
+
+  if (randomMasks)
+  {
+    attribs.event_mask = 0;
+    attribs.do_not_propagate_mask = 0;
+
+    for (m = -1; ++m < (int) (sizeof (inputMasks) / sizeof (long)); )
+    {
+      if (rand () & 1) attribs.event_mask |= inputMasks[m];
+      if (m < 3 && rand () & 1)
+      {
+        attribs.do_not_propagate_mask |= inputMasks[m];
+      }
+    }
+
+    which = CWEventMask | CWDontPropagate;
+  }
+
+  window = XCreateWindow (d, parent, rand () % 64, rand () % 64, 16, 16, 0,
+                          CopyFromParent, InputOutput, CopyFromParent,
+                          which, &attribs);
+  (void) XMapWindow (d, window);
+
+  return window;
+}
+
+/*
+ *  Function for building the tree, breadth first.
+ */
+static void
+buildTree (int depth, int width)
+{
+  int level;    /* loop counter            */
+  int first;    /* first parent this level */
+  int last;     /* last one + 1            */
+  int p;        /* loop counter            */
+  int c;        /* loop counter            */
+  int size = 1; /* as it says              */
+
+  for (level = -1, p = 1; ++level < depth; size += (p *= width));
+
+  if (!(tree = (Window*) malloc (size * sizeof (Window)))) /* = intended */
+  {
+    (void) fprintf (stderr, "Out of memory.\n");
+    exit (EXIT_FAILURE);
+  }
+
+  tree[treeSize++] = DefaultRootWindow (d);
+
+  for (level = -1, first = 0, last = 1; ++level < depth; )
+  {
+    for (p = first - 1; ++p < last; )
+    {
+      for (c = -1; ++c < width; ) tree[treeSize++] = createWindow (tree[p]);
+    }
+
+    first = last;
+    last = treeSize;
+  }
+
+  (void) XSync (d, False);
+}
+
+static void
+usage (const char* progName)
+{
+  (void) fprintf (stderr,
+                  "Usage : %s [-depth n] [-width n] [-rate n] [-seconds n]\n"
+                  "        [-lifetime ms] [-masks] [-seed n]\n"
+                  "        [-metrics socket] [-catchup secs]\n", progName);
+  exit (EXIT_FAILURE);
+}
+
+int
+main (int argc, char* argv[])
+{
+  int          depth = 4;        /* as it says                   */
+  int          width = 6;        /* as it says                   */
+  long         rate = 1000;      /* transient windows per second */
+  long         seconds = 10;     /* length of the storm          */
+  long         lifetime = 500;   /* of a transient, in ms        */
+  long         catchup = 120;    /* max wait for the queue       */
+  Window*      transients;       /* FIFO of living transients    */
+  long*        born;             /* when they were created       */
+  long         maxAlive;         /* size of the FIFO             */
+  long         head = 0;         /* oldest transient             */
+  long         alive = 0;        /* as it says                   */
+  long         created = 0;      /* as it says                   */
+  long         start;            /* of the storm                 */
+  long         now;              /* as it says                   */
+  long         tick;             /* as it says                   */
+  double       maxDepth = 0;     /* deepest queue seen           */
+  daemonStats  before;           /* as it says                   */
+  daemonStats  after;            /* as it says                   */
+  daemonStats  sample;           /* as it says                   */
+  Bool         haveStats;        /* as it says                   */
+  int          a;                /* loop counter                 */
+
+  for (a = 0; ++a < argc; )
+  {
+    if      (!strcmp (argv[a], "-masks"))                  randomMasks = True;
+    else if (a + 1 >= argc)                                usage (argv[0]);
+    else if (!strcmp (argv[a], "-depth"))    depth = atoi (argv[++a]);
+    else if (!strcmp (argv[a], "-width"))    width = atoi (argv[++a]);
+    else if (!strcmp (argv[a], "-rate"))     rate = atol (argv[++a]);
+    else if (!strcmp (argv[a], "-seconds"))  seconds = atol (argv[++a]);
+    else if (!strcmp (argv[a], "-lifetime")) lifetime = atol (argv[++a]);
+    else if (!strcmp (argv[a], "-catchup"))  catchup = atol (argv[++a]);
+    else if (!strcmp (argv[a], "-seed"))     srand (atoi (argv[++a]));
+    else if (!strcmp (argv[a], "-metrics"))  metricsPath = argv[++a];
+    else                                                   usage (argv[0]);
+  }
+
+  if (depth < 0 || width < 1 || rate < 1 || seconds < 0 || lifetime < 0)
+  {
+    usage (argv[0]);
+  }
+
+  if (!(d = XOpenDisplay (0))) /* = intended */
+  {
+    (void) fprintf (stderr, "Couldn't connect to %s\n", XDisplayName (0));
+    return EXIT_FAILURE;
+  }
+
+  haveStats = getStats (&before);
+  if (metricsPath && !haveStats)
+  {
+    (void) fprintf (stderr, "Can't get metrics from %s.\n", metricsPath);
+  }
+
+  now = milliNow ();
+  buildTree (depth, width);
+  (void) printf ("tree_windows %d\n", treeSize - 1);
+  (void) printf ("tree_ms %ld\n", milliNow () - now);
+
+ /*
+  *  The storm itself. Every TICK, create whatever is due and destroy
+  *  whatever has lived long enough.
+  */
+  maxAlive = rate * (lifetime + TICK) / 1000 + rate * TICK / 1000 + 1;
+  transients = (Window*) malloc (maxAlive * sizeof (Window));
+  born = (long*) malloc (maxAlive * sizeof (long));
+
+  if (!transients || !born)
+  {
+    (void) fprintf (stderr, "Out of memory.\n");
+    return EXIT_FAILURE;
+  }
+
+  start = milliNow ();
+
+  for (tick = start; (now = milliNow ()) - start < seconds * 1000; )
+  {
+    long due = (now - start) * rate / 1000;
+
+    while (alive && born[head] + lifetime <= now)
+    {
+      (void) XDestroyWindow (d, transients[head]);
+      head = (head + 1) % maxAlive;
+      --alive;
+    }
+
+    while (created < due && alive < maxAlive)
+    {
+      long slot = (head + alive++) % maxAlive;
+
+      transients[slot] = createWindow (tree[rand () % treeSize]);
+      born[slot] = now;
+      ++created;
+    }
+
+    (void) XFlush (d);
+
+    if (now / 1000 != tick / 1000 && getStats (&sample))
+    {
+      if (sample.queueDepth > maxDepth) maxDepth = sample.queueDepth;
+    }
+
+    tick = now;
+    (void) usleep (TICK * 1000);
+  }
+
+  while (alive)
+  {
+    (void) XDestroyWindow (d, transients[head]);
+    head = (head + 1) % maxAlive;
+    --alive;
+  }
+
+  (void) XSync (d, False);
+  now = milliNow ();
+  (void) printf ("transients_created %ld\n", created);
+  (void) printf ("transients_per_second %.1f\n",
+                 seconds ? created * 1000.0 / (now - start) : 0.0);
+
+  if (!haveStats) return EXIT_SUCCESS;
+
+ /*
+  *  Wait for xautolock to work through its queue.
+  */
+  after = before;
+
+  while (getStats (&after) && after.queueDepth > 0)
+  {
+    if (after.queueDepth > maxDepth) maxDepth = after.queueDepth;
+    if (milliNow () - now > catchup * 1000) break;
+    (void) usleep (100000);
+  }
+
+  (void) printf ("xautolock_requests %.0f\n",
+                 after.requests - before.requests);
+  (void) printf ("xautolock_round_trips %.0f\n",
+                 after.roundTrips - before.roundTrips);
+  (void) printf ("xautolock_max_queue_depth %.0f\n", maxDepth);
+
+  if (after.queueDepth > 0)
+  {
+    (void) printf ("xautolock_catchup_ms -1\n");
+  }
+  else
+  {
+    (void) printf ("xautolock_catchup_ms %ld\n", milliNow () - now);
+  }
+
+  (void) XCloseDisplay (d);
+  return EXIT_SUCCESS;
+}